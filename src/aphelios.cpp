@@ -3,6 +3,8 @@
 #include <cassert>
 #include <charconv>
 #include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <ftxui/component/screen_interactive.hpp>
 #include <ftxui/dom/elements.hpp>
 #include <ftxui/dom/table.hpp>
@@ -16,7 +18,7 @@
 
  ApheliOS::ApheliOS()
  {
-     memory = std::make_shared<Memory>();
+     // memory is created by initialize once the configuration is known
      shell = std::make_unique<Shell>(*this);
      create_session("pts", true, shell->shell_process);
      ShellUtils::print_header(shell->output_buffer);
@@ -47,6 +49,7 @@ void ApheliOS::run_system_clock()
          any_core_active_this_tick.store(false);
 
          increment_cpu_tick();
+         memory->sample_working_sets();
      }
  }
 
@@ -135,6 +138,9 @@ void ApheliOS::process_command(const std::string &input_raw)
      } else if (command_lower == "vmstat") {
          if (!in_main("vmstat")) return;
          display_vmstat();
+     } else if (command_lower == "vmstat -l") {
+         if (!in_main("vmstat")) return;
+         display_fault_latency();
      } else if (command_lower == "process-smi") {
          if (!is_initial_shell) {
              const std::string smi_output = current_session->process->get_smi_string();
@@ -166,7 +172,20 @@ bool ApheliOS::initialize(const std::string& config_file)
 
      config = *config_result;
 
-     memory = std::make_shared<Memory>(config->max_overall_mem, config->mem_per_frame, config->max_overall_mem / config->mem_per_frame);
+     memory = std::make_shared<Memory>(config->max_overall_mem, config->mem_per_frame, config->max_overall_mem / config->mem_per_frame, config->num_cpu);
+     memory->set_replacement_policy(config->page_replacement, config->working_set_window);
+     memory->set_working_set_window(config->working_set_window);
+     if (!memory->set_backing_store(config->backing_store, config->backing_store_sync_interval)) {
+         shell->output_buffer.emplace_back(std::format("Warning: could not use the {} backing store, using {}", config->backing_store, memory->get_backing_store_name()));
+     }
+     memory->set_compressed_pool(config->compressed_pool_size);
+     memory->set_io_threads(config->io_threads);
+     memory->set_latency_tracking(config->fault_latency_tracking);
+     memory->start_reclaim_daemon(config->reclaim_low_watermark, config->reclaim_high_watermark);
+     memory->set_fault_around(config->fault_around_pages, config->readahead_max_pages);
+     if (config->async_page_faults) {
+         memory->start_io_worker();
+     }
      shell->shell_process->memory = memory;
 
      if (current_session && current_session->process) {
@@ -190,6 +209,9 @@ bool ApheliOS::initialize(const std::string& config_file)
     
     // Set quantum cycles for round robin
     scheduler->set_quantum_cycles(config->quantum_cycles);
+    scheduler->set_load_control(memory, config->swap_out_fault_rate);
+    scheduler->set_execution_mode(config->execution_mode == "reference" ? ExecutionMode::eReference : ExecutionMode::eBytecode);
+    scheduler->set_log_capacity(config->log_buffer_size);
 
     scheduler->start();
 
@@ -202,6 +224,18 @@ bool ApheliOS::initialize(const std::string& config_file)
      shell->output_buffer.emplace_back(std::format("  Quantum: {}", config->quantum_cycles));
      shell->output_buffer.emplace_back(std::format("  Batch Process Freq: {}", config->batch_process_freq));
      shell->output_buffer.emplace_back(std::format("  Min/Max Instructions: {}/{}", config->min_ins, config->max_ins));
+     shell->output_buffer.emplace_back(std::format("  Page Replacement: {}", config->page_replacement));
+     shell->output_buffer.emplace_back(std::format("  Working-set Window: {} ticks", config->working_set_window));
+     shell->output_buffer.emplace_back(std::format("  Backing Store: {}", memory->get_backing_store_name()));
+     shell->output_buffer.emplace_back(std::format("  Reclaim Watermarks: {}%/{}%", config->reclaim_low_watermark, config->reclaim_high_watermark));
+     shell->output_buffer.emplace_back(std::format("  Fault-around/Max Readahead: {}/{} pages", config->fault_around_pages, config->readahead_max_pages));
+     shell->output_buffer.emplace_back(std::format("  Compressed Pool: {} B", config->compressed_pool_size));
+     shell->output_buffer.emplace_back(std::format("  Async Page Faults: {}", config->async_page_faults ? "on" : "off"));
+     shell->output_buffer.emplace_back(std::format("  I/O Threads: {}", config->io_threads));
+     shell->output_buffer.emplace_back(std::format("  Fault Latency Tracking: {}", config->fault_latency_tracking ? "on" : "off"));
+     shell->output_buffer.emplace_back(std::format("  Swap-out Fault Rate: {} per 1k instructions", config->swap_out_fault_rate));
+     shell->output_buffer.emplace_back(std::format("  Execution Mode: {}", config->execution_mode));
+     shell->output_buffer.emplace_back(std::format("  Log Buffer: {} entries per process", config->log_buffer_size));
 
      return true;
  }
@@ -530,6 +564,13 @@ void ApheliOS::display_vmstat() {
 
      uint64_t pages_in = memory->get_pages_paged_in();
      uint64_t pages_out = memory->get_pages_paged_out();
+     uint64_t tlb_hits = memory->get_tlb_hits();
+     uint64_t tlb_misses = memory->get_tlb_misses();
+
+     // Accesses are counted by the per-core TLBs, so this covers everything the CPU cores executed
+     uint64_t page_faults = memory->get_page_faults();
+     uint64_t accesses = tlb_hits + tlb_misses;
+     double faults_per_1k = accesses > 0 ? static_cast<double>(page_faults) * 1000.0 / accesses : 0.0;
 
      shell->output_buffer.emplace_back(" ");
      shell->output_buffer.emplace_back("===================================");
@@ -542,9 +583,117 @@ void ApheliOS::display_vmstat() {
      shell->output_buffer.emplace_back(std::format("{:>12} active cpu ticks", active_ticks));
      shell->output_buffer.emplace_back(std::format("{:>12} total cpu ticks", total_ticks));
      shell->output_buffer.emplace_back(std::format("{:>12} pages paged in", pages_in));
+     shell->output_buffer.emplace_back(std::format("{:>12} pages read ahead", memory->get_pages_read_ahead()));
+     shell->output_buffer.emplace_back(std::format("{:>12} readahead hits", memory->get_readahead_hits()));
      shell->output_buffer.emplace_back(std::format("{:>12} pages paged out", pages_out));
+     shell->output_buffer.emplace_back(std::format("{:>12} tlb hits", tlb_hits));
+     shell->output_buffer.emplace_back(std::format("{:>12} tlb misses", tlb_misses));
+     shell->output_buffer.emplace_back(std::format("{:>12} page replacement policy", memory->get_replacement_policy_name()));
+     shell->output_buffer.emplace_back(std::format("{:>12} backing store", memory->get_backing_store_name()));
+     shell->output_buffer.emplace_back(std::format("{:>12} page faults", page_faults));
+     if (auto pool = memory->get_compressed_pool_stats()) {
+         const uint64_t lookups = pool->hits + pool->misses;
+         const double hit_rate = lookups > 0 ? static_cast<double>(pool->hits) * 100.0 / lookups : 0.0;
+         const double ratio = pool->compressed_bytes > 0
+                                  ? static_cast<double>(pool->original_bytes) / pool->compressed_bytes : 0.0;
+         shell->output_buffer.emplace_back(std::format("{:>12} compressed pool hits", pool->hits));
+         shell->output_buffer.emplace_back(std::format("{:>12} compressed pool misses", pool->misses));
+         shell->output_buffer.emplace_back(std::format("{:>11.1f}% compressed pool hit rate", hit_rate));
+         shell->output_buffer.emplace_back(std::format("{:>12} compressed pages held", pool->stored_pages));
+         shell->output_buffer.emplace_back(std::format("{:>11.2f}x compression ratio", ratio));
+         shell->output_buffer.emplace_back(std::format("{:>12} pages spilled to backing store", pool->spilled));
+         shell->output_buffer.emplace_back(std::format("{:>12} incompressible pages", pool->rejected));
+     }
+     shell->output_buffer.emplace_back(std::format("{:>12} async page-ins", memory->get_async_page_ins()));
+     shell->output_buffer.emplace_back(std::format("{:>12} async page writes", memory->get_async_page_writes()));
+     shell->output_buffer.emplace_back(std::format("{:>12} page writes coalesced", memory->get_coalesced_page_writes()));
+     shell->output_buffer.emplace_back(std::format("{:>12} reads from in-flight writes", memory->get_inflight_read_hits()));
+     shell->output_buffer.emplace_back(std::format("{:>12} waits on in-flight writes", memory->get_inflight_write_waits()));
+     shell->output_buffer.emplace_back(std::format("{:>12} evictions", memory->get_evictions()));
+     shell->output_buffer.emplace_back(std::format("{:>12} direct reclaims", memory->get_direct_reclaims()));
+     shell->output_buffer.emplace_back(std::format("{:>12} background reclaims", memory->get_background_reclaims()));
+     shell->output_buffer.emplace_back(std::format("{:>12} pages pre-cleaned", memory->get_pages_precleaned()));
+     shell->output_buffer.emplace_back(std::format("{:>12} shared pages", memory->get_shared_page_count()));
+     shell->output_buffer.emplace_back(std::format("{:>12} shared page mappings", memory->get_shared_mapping_count()));
+     shell->output_buffer.emplace_back(std::format("{:>12} copy-on-write faults", memory->get_cow_copies()));
+     shell->output_buffer.emplace_back(std::format("{:>12} instructions retired", scheduler->get_instructions_retired()));
+     shell->output_buffer.emplace_back(std::format("{:>12} processes swapped out", scheduler->get_swapped_out_count()));
+     shell->output_buffer.emplace_back(std::format("{:>12} process swap-outs", scheduler->get_swap_outs()));
+     shell->output_buffer.emplace_back(std::format("{:>12} process swap-ins", scheduler->get_swap_ins()));
+     shell->output_buffer.emplace_back(std::format("{:>12} pages freed by swap-out", memory->get_pages_swapped_out()));
+     shell->output_buffer.emplace_back(std::format("{:>12} B working set ({} ticks)", memory->get_total_working_set(), memory->get_working_set_window()));
+     shell->output_buffer.emplace_back(std::format("{:>12} thrashing", memory->is_thrashing() ? "yes" : "no"));
+     shell->output_buffer.emplace_back(std::format("{:>12} ticks spent thrashing", memory->get_thrashing_ticks()));
+     shell->output_buffer.emplace_back(std::format("{:>12.3f} faults per 1k accesses", faults_per_1k));
      shell->output_buffer.emplace_back("===================================");
+     for (const auto& [pid, working_set] : memory->get_process_working_sets()) {
+         shell->output_buffer.emplace_back(std::format("{:>12} B working set of pid {}", working_set, pid));
+     }
+
+ }
 
+void ApheliOS::display_fault_latency() {
+     if (!is_initialized()) {
+         shell->output_buffer.emplace_back("Error: ApheliOS is not initialized.");
+         return;
+     }
+
+     if (!memory->is_latency_tracking()) {
+         shell->output_buffer.emplace_back("Fault latency tracking is off (fault-latency-tracking 0 in the config).");
+         return;
+     }
+
+     constexpr std::array<std::string_view, NUM_FAULT_KINDS> kind_names{"minor", "major", "eviction"};
+     const auto system_latency = memory->get_fault_latency();
+     const auto process_latencies = memory->get_process_fault_latencies();
+
+     auto add_rows = [&](const std::string& scope, const FaultLatencySnapshot& latency) {
+         for (size_t kind = 0; kind < NUM_FAULT_KINDS; kind++) {
+             const auto& histogram = latency[kind];
+             if (histogram.total == 0) continue;
+             shell->output_buffer.emplace_back(std::format("{:<10} {:<9} {:>9} {:>10} {:>10} {:>10} {:>10}", scope, kind_names[kind],
+                 histogram.total, histogram.percentile(0.5), histogram.percentile(0.99),
+                 histogram.percentile(0.999), histogram.max));
+         }
+     };
+
+     shell->output_buffer.emplace_back(" ");
+     shell->output_buffer.emplace_back("==========================================================================");
+     shell->output_buffer.emplace_back("|                      FAULT LATENCY (nanoseconds)                       |");
+     shell->output_buffer.emplace_back("==========================================================================");
+     shell->output_buffer.emplace_back(std::format("{:<10} {:<9} {:>9} {:>10} {:>10} {:>10} {:>10}",
+         "scope", "kind", "count", "p50", "p99", "p99.9", "max"));
+     add_rows("system", system_latency);
+     for (const auto& [pid, latency] : process_latencies) {
+         add_rows(std::format("pid {}", pid), latency);
+     }
+     shell->output_buffer.emplace_back("==========================================================================");
+
+     // The dump keeps every non-empty bucket, for plotting or comparing runs
+     std::filesystem::create_directories("logs");
+     const std::string filename = "logs/fault-latency.txt";
+     std::ofstream out(filename, std::ios::out | std::ios::trunc);
+     if (!out.is_open()) {
+         shell->output_buffer.emplace_back(std::format("Error: could not write {}", filename));
+         return;
+     }
+
+     auto dump = [&](const std::string& scope, const FaultLatencySnapshot& latency) {
+         for (size_t kind = 0; kind < NUM_FAULT_KINDS; kind++) {
+             const auto& histogram = latency[kind];
+             out << std::format("{} {} count={} max={}\n", scope, kind_names[kind], histogram.total, histogram.max);
+             for (size_t bucket = 0; bucket < histogram.counts.size(); bucket++) {
+                 if (histogram.counts[bucket] == 0) continue;
+                 out << std::format("  {:>12} {:>12} {:>10}\n", LatencyHistogram::bucket_lower(bucket),
+                     LatencyHistogram::bucket_upper(bucket), histogram.counts[bucket]);
+             }
+         }
+     };
+     dump("system", system_latency);
+     for (const auto& [pid, latency] : process_latencies) {
+         dump(std::format("pid {}", pid), latency);
+     }
+     shell->output_buffer.emplace_back(std::format("Histogram buckets saved to {}", filename));
  }
 
 void ApheliOS::display_process_smi() {
@@ -579,6 +728,8 @@ void ApheliOS::display_process_smi() {
     shell->output_buffer.emplace_back(std::format("CPU-Util: {:.2f}%", cpu_util));
     shell->output_buffer.emplace_back(std::format("Memory Usage: {}B / {}B", allocated_memory, total_memory));
     shell->output_buffer.emplace_back(std::format("Memory Util: {:.2f}%", memory_util));
+    shell->output_buffer.emplace_back(std::format("Working Set: {}B / {}B{}", memory->get_total_working_set(), total_memory,
+        memory->is_thrashing() ? " (thrashing)" : ""));
 
     shell->output_buffer.emplace_back(" ");
     shell->output_buffer.emplace_back("=================================================");
@@ -593,9 +744,10 @@ void ApheliOS::display_process_smi() {
 
             size_t process_memory = memory->get_process_memory_usage(snapshot.id);
             size_t process_pages = memory->calculate_pages_needed(process_memory);
+            size_t working_set = memory->get_process_working_set(snapshot.id);
 
-            shell->output_buffer.emplace_back(std::format("{:<20} {:<10}B (pages: {})",
-                snapshot.name, process_memory, process_pages));
+            shell->output_buffer.emplace_back(std::format("{:<20} {:<10}B (pages: {}, working set: {}B)",
+                snapshot.name, process_memory, process_pages, working_set));
         }
     }
 
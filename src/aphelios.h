@@ -64,6 +64,7 @@ private:
     
     void display_process_smi();
     void display_vmstat();
+    void display_fault_latency();
     
     void start_process_generation();
     void stop_process_generation();
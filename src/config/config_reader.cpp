@@ -75,6 +75,51 @@ std::expected<CPUConfig, ConfigError> ConfigReader::parse_config()
     if (auto max_mem = get_value<int>("max-mem-per-proc")) {
         config.max_mem_per_proc = *max_mem;
     }
+    if (auto policy = get_value<std::string>("page-replacement")) {
+        config.page_replacement = *policy;
+    }
+    if (auto window = get_value<int>("working-set-window")) {
+        config.working_set_window = *window;
+    }
+    if (auto store = get_value<std::string>("backing-store")) {
+        config.backing_store = *store;
+    }
+    if (auto interval = get_value<int>("backing-store-sync-interval")) {
+        config.backing_store_sync_interval = *interval;
+    }
+    if (auto low = get_value<int>("reclaim-low-watermark")) {
+        config.reclaim_low_watermark = *low;
+    }
+    if (auto high = get_value<int>("reclaim-high-watermark")) {
+        config.reclaim_high_watermark = *high;
+    }
+    if (auto around = get_value<int>("fault-around-pages")) {
+        config.fault_around_pages = *around;
+    }
+    if (auto readahead = get_value<int>("readahead-max-pages")) {
+        config.readahead_max_pages = *readahead;
+    }
+    if (auto pool_size = get_value<int>("compressed-pool-size")) {
+        config.compressed_pool_size = *pool_size;
+    }
+    if (auto async_faults = get_value<int>("async-page-faults")) {
+        config.async_page_faults = *async_faults;
+    }
+    if (auto threads = get_value<int>("io-threads")) {
+        config.io_threads = *threads;
+    }
+    if (auto tracking = get_value<int>("fault-latency-tracking")) {
+        config.fault_latency_tracking = *tracking;
+    }
+    if (auto rate = get_value<int>("swap-out-fault-rate")) {
+        config.swap_out_fault_rate = *rate;
+    }
+    if (auto mode = get_value<std::string>("execution-mode")) {
+        config.execution_mode = *mode;
+    }
+    if (auto log_size = get_value<int>("log-buffer-size")) {
+        config.log_buffer_size = *log_size;
+    }
 
     if (!config.validate()) {
         return std::unexpected(ConfigError::InvalidValue);
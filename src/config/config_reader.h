@@ -58,6 +58,21 @@ struct CPUConfig
     int mem_per_frame{};
     int min_mem_per_proc{};
     int max_mem_per_proc{};
+    std::string page_replacement{"fifo"};
+    int working_set_window{100};
+    std::string backing_store{"fstream"};
+    int backing_store_sync_interval{0};
+    int reclaim_low_watermark{0};
+    int reclaim_high_watermark{0};
+    int fault_around_pages{0};
+    int readahead_max_pages{0};
+    int compressed_pool_size{0};
+    int async_page_faults{0};
+    int io_threads{0};
+    int fault_latency_tracking{1};
+    int swap_out_fault_rate{0};
+    std::string execution_mode{"bytecode"};
+    int log_buffer_size{1000};
 
     [[nodiscard]] bool validate() const
     {
@@ -68,7 +83,19 @@ struct CPUConfig
                min_ins >= 1 && min_ins <= std::numeric_limits<int>::max() &&
                max_ins >= 1 && max_ins <= std::numeric_limits<int>::max() &&
                min_mem_per_proc >= 64 && max_mem_per_proc <= 65536 &&
-               min_mem_per_proc <= max_mem_per_proc;
+               min_mem_per_proc <= max_mem_per_proc &&
+               (page_replacement == "fifo" || page_replacement == "clock" || page_replacement == "lru" ||
+                page_replacement == "lfu" || page_replacement == "wsclock") &&
+               working_set_window >= 1 &&
+               (backing_store == "fstream" || backing_store == "mmap") &&
+               backing_store_sync_interval >= 0 &&
+               reclaim_low_watermark >= 0 && reclaim_low_watermark <= reclaim_high_watermark &&
+               reclaim_high_watermark <= 100 &&
+               fault_around_pages >= 0 && readahead_max_pages >= 0 &&
+               compressed_pool_size >= 0 && (async_page_faults == 0 || async_page_faults == 1) &&
+               io_threads >= 0 && io_threads <= 64 &&
+               (fault_latency_tracking == 0 || fault_latency_tracking == 1) && swap_out_fault_rate >= 0 &&
+               (execution_mode == "bytecode" || execution_mode == "reference") && log_buffer_size >= 1;
     }
 };
 
@@ -0,0 +1,123 @@
+#include "async_io.h"
+#include <algorithm>
+
+AsyncPageIO::AsyncPageIO(BackingStore &store, unsigned threads) : store(store)
+{
+    threads = std::max(threads, 1u);
+    workers.reserve(threads);
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back(&AsyncPageIO::worker_loop, this);
+    }
+}
+
+AsyncPageIO::~AsyncPageIO()
+{
+    {
+        std::lock_guard lock(queue_mutex);
+        stopping = true;
+    }
+    queue_cv.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void AsyncPageIO::worker_loop()
+{
+    while (true) {
+        Chunk chunk;
+        {
+            std::unique_lock lock(queue_mutex);
+            queue_cv.wait(lock, [this] { return !chunks.empty() || stopping; });
+            if (chunks.empty()) return;
+
+            chunk = std::move(chunks.front());
+            chunks.pop_front();
+        }
+
+        Batch& batch = *chunk.batch;
+        bool ok = true;
+        if (batch.write) {
+            for (size_t i = chunk.begin; i < chunk.end; i++) {
+                ok &= store.write_page(batch.requests[i].slot, batch.requests[i].data);
+            }
+        } else {
+            // Reads of one chunk still go to the store as one batch
+            std::vector<uint32_t> slots;
+            std::vector<uint8_t*> pages;
+            for (size_t i = chunk.begin; i < chunk.end; i++) {
+                slots.push_back(batch.requests[i].slot);
+                pages.push_back(batch.requests[i].data);
+            }
+            ok = store.read_pages(slots, pages);
+        }
+
+        if (!ok) batch.ok.store(false);
+        if (batch.chunks_left.fetch_sub(1) == 1 && batch.on_complete) {
+            batch.on_complete(batch.ok.load());
+        }
+    }
+}
+
+void AsyncPageIO::submit(bool write, std::vector<PageIORequest> requests, std::function<void(bool)> on_complete)
+{
+    if (requests.empty()) {
+        if (on_complete) on_complete(true);
+        return;
+    }
+
+    auto batch = std::make_shared<Batch>();
+    batch->write = write;
+    batch->requests = std::move(requests);
+    batch->on_complete = std::move(on_complete);
+
+    // One chunk per worker at most, so a batch never queues more work than can run at once
+    const size_t count = batch->requests.size();
+    const size_t num_chunks = std::min(count, std::max<size_t>(workers.size(), 1));
+    const size_t per_chunk = (count + num_chunks - 1) / num_chunks;
+    batch->chunks_left.store((count + per_chunk - 1) / per_chunk);
+
+    {
+        std::lock_guard lock(queue_mutex);
+        for (size_t begin = 0; begin < count; begin += per_chunk) {
+            chunks.push_back({batch, begin, std::min(begin + per_chunk, count)});
+        }
+    }
+    queue_cv.notify_all();
+}
+
+void AsyncPageIO::submit_writes(std::vector<PageIORequest> requests, std::function<void(bool)> on_complete)
+{
+    submit(true, std::move(requests), std::move(on_complete));
+}
+
+void AsyncPageIO::submit_reads(std::vector<PageIORequest> requests, std::function<void(bool)> on_complete)
+{
+    submit(false, std::move(requests), std::move(on_complete));
+}
+
+bool AsyncPageIO::read_pages(std::span<const uint32_t> slots, std::span<uint8_t* const> pages)
+{
+    std::vector<PageIORequest> requests;
+    requests.reserve(slots.size());
+    for (size_t i = 0; i < slots.size(); i++) {
+        requests.push_back({slots[i], pages[i]});
+    }
+
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    bool done = false;
+    bool result = true;
+
+    submit_reads(std::move(requests), [&](bool ok) {
+        std::lock_guard lock(done_mutex);
+        result = ok;
+        done = true;
+        done_cv.notify_one();
+    });
+
+    std::unique_lock lock(done_mutex);
+    done_cv.wait(lock, [&] { return done; });
+    return result;
+}
@@ -0,0 +1,69 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "backing_store.h"
+
+struct PageIORequest
+{
+    uint32_t slot;
+    uint8_t* data;
+};
+
+// Thread pool that moves pages between memory and a BackingStore off the calling thread. A batch is
+// split across the workers, so its pages complete in any order; on_complete runs once, on the
+// worker that finishes last, with whether every transfer succeeded. The caller keeps the buffers
+// alive and must not submit two transfers of the same slot that could overlap.
+class AsyncPageIO
+{
+    struct Batch
+    {
+        bool write;
+        std::vector<PageIORequest> requests;
+        std::function<void(bool)> on_complete;
+        std::atomic<size_t> chunks_left{0};
+        std::atomic<bool> ok{true};
+    };
+
+    struct Chunk
+    {
+        std::shared_ptr<Batch> batch;
+        size_t begin;
+        size_t end;
+    };
+
+    BackingStore& store;
+    std::vector<std::thread> workers;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<Chunk> chunks;
+    bool stopping = false;
+
+    void worker_loop();
+    void submit(bool write, std::vector<PageIORequest> requests, std::function<void(bool)> on_complete);
+
+public:
+    AsyncPageIO(BackingStore& store, unsigned threads);
+    // Finishes every submitted batch before returning
+    ~AsyncPageIO();
+
+    void submit_writes(std::vector<PageIORequest> requests, std::function<void(bool)> on_complete);
+    void submit_reads(std::vector<PageIORequest> requests, std::function<void(bool)> on_complete);
+
+    // Spreads the reads across the workers and returns once they are all done
+    bool read_pages(std::span<const uint32_t> slots, std::span<uint8_t* const> pages);
+
+    size_t get_thread_count() const { return workers.size(); }
+};
+
+#endif //ASYNC_IO_H
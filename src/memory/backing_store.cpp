@@ -0,0 +1,345 @@
+#include "backing_store.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+BackingStore::BackingStore(const std::string &file_path, size_t max_pages, uint32_t page_size) :
+    used_words((max_pages + 63) / 64, 0), full_words((used_words.size() + 63) / 64, 0),
+    extent_words(std::max<size_t>(EXTENT_BYTES / page_size / 64, 1)),
+    page_size(page_size), max_pages(max_pages), page_file_path(file_path)
+{
+    // Mark bits past the last real slot, and summary bits past the last word, as taken
+    if (max_pages % 64 != 0) {
+        used_words.back() = ~0ULL << (max_pages % 64);
+    }
+    if (used_words.size() % 64 != 0) {
+        full_words.back() = ~0ULL << (used_words.size() % 64);
+    }
+}
+
+bool BackingStore::can_open_file() const
+{
+    const std::filesystem::path path(page_file_path);
+    std::error_code ec;
+    const auto status = std::filesystem::status(path, ec);
+    if (std::filesystem::exists(status)) {
+        return std::filesystem::is_regular_file(status) &&
+               std::fstream(path, std::ios::in | std::ios::out | std::ios::binary).is_open();
+    }
+
+    const auto directory = path.parent_path();
+    return directory.empty() || std::filesystem::is_directory(directory, ec);
+}
+
+std::optional<size_t> BackingStore::find_free_word(size_t first, size_t last) const
+{
+    for (size_t summary = first / 64; summary * 64 < last; summary++) {
+        uint64_t candidates = ~full_words[summary];
+        if (summary == first / 64) {
+            candidates &= ~0ULL << (first % 64);
+        }
+        if (candidates == 0) continue;
+
+        const size_t word = summary * 64 + std::countr_zero(candidates);
+        if (word < last) return word;
+        break;
+    }
+    return std::nullopt;
+}
+
+std::optional<uint32_t> BackingStore::allocate_slot()
+{
+    std::lock_guard lock(slot_mutex);
+
+    // Next-fit: continue from the last word that had room, then wrap around to the start
+    auto word = find_free_word(next_fit_word, committed_words);
+    if (!word) word = find_free_word(0, std::min(next_fit_word, committed_words));
+    if (!word) {
+        // Every slot the file holds is taken, so it grows by an extent
+        if (committed_words == used_words.size()) return std::nullopt;
+
+        const size_t grown_words = std::min(committed_words + extent_words, used_words.size());
+        if (!grow_file(std::min(grown_words * 64, max_pages))) return std::nullopt;
+        word = committed_words;
+        committed_words = grown_words;
+    }
+
+    const int bit = std::countr_zero(~used_words[*word]);
+    used_words[*word] |= 1ULL << bit;
+    if (used_words[*word] == ~0ULL) {
+        full_words[*word / 64] |= 1ULL << (*word % 64);
+    }
+
+    next_fit_word = *word;
+    return static_cast<uint32_t>(*word * 64 + bit);
+}
+
+void BackingStore::free_slot(uint32_t slot)
+{
+    std::lock_guard lock(slot_mutex);
+    if (slot >= max_pages) return;
+
+    used_words[slot / 64] &= ~(1ULL << (slot % 64));
+    full_words[slot / 64 / 64] &= ~(1ULL << (slot / 64 % 64));
+
+    // Freeing the last used slot of an extent hands its blocks back. The padding past max_pages is
+    // always marked used, so it is masked out of the final word.
+    const size_t first_word = slot / 64 / extent_words * extent_words;
+    const size_t last_word = std::min(first_word + extent_words, committed_words);
+    for (size_t word = first_word; word < last_word; word++) {
+        uint64_t in_use = used_words[word];
+        if (word == used_words.size() - 1 && max_pages % 64 != 0) {
+            in_use &= ~(~0ULL << (max_pages % 64));
+        }
+        if (in_use != 0) return;
+    }
+    punch_hole(static_cast<uint32_t>(first_word * 64), std::min(last_word * 64, max_pages) - first_word * 64);
+}
+
+bool BackingStore::read_pages(std::span<const uint32_t> slots, std::span<uint8_t* const> pages)
+{
+    bool ok = true;
+    for (size_t i = 0; i < slots.size(); i++) {
+        ok &= read_page(slots[i], pages[i]);
+    }
+    return ok;
+}
+
+bool BackingStore::write_pages(std::span<const uint32_t> slots, std::span<const uint8_t* const> pages)
+{
+    bool ok = true;
+    for (size_t i = 0; i < slots.size(); i++) {
+        ok &= write_page(slots[i], pages[i]);
+    }
+    return ok;
+}
+
+FileBackingStore::FileBackingStore(const std::string &file_path, size_t max_pages, uint32_t page_size) :
+    BackingStore(file_path, max_pages, page_size)
+{
+}
+
+FileBackingStore::~FileBackingStore()
+{
+    if (page_file.is_open()) {
+        page_file.close();
+    }
+#ifdef __linux__
+    if (hole_descriptor >= 0) close(hole_descriptor);
+#endif
+}
+
+bool FileBackingStore::grow_file(size_t pages)
+{
+    std::lock_guard lock(store_mutex);
+    if (!page_file.is_open()) {
+        // Truncating drops whatever an earlier run left in the file
+        page_file.open(page_file_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!page_file.is_open()) return false;
+#ifdef __linux__
+        hole_descriptor = open(page_file_path.c_str(), O_WRONLY);
+#endif
+    }
+
+    // Writing the last byte sets the size; the gap before it stays sparse until pages land there
+    page_file.seekp(static_cast<std::streamoff>(pages) * page_size - 1);
+    page_file.write("", 1);
+    page_file.flush();
+    return page_file.good();
+}
+
+void FileBackingStore::punch_hole(uint32_t first, size_t count)
+{
+#ifdef __linux__
+    if (hole_descriptor < 0) return;
+
+    // Buffered page-outs of the range must reach the file before the hole, not land after it
+    std::lock_guard lock(store_mutex);
+    page_file.flush();
+    fallocate(hole_descriptor, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+              static_cast<off_t>(first) * page_size, static_cast<off_t>(count) * page_size);
+#endif
+}
+
+// Every transfer starts from a clear stream state, so one failed transfer does not fail all later
+// ones. Writes are flushed before they report success; the next seek would flush them anyway.
+bool FileBackingStore::write_page(uint32_t slot, const uint8_t *page_data)
+{
+    std::lock_guard lock(store_mutex);
+    page_file.clear();
+    page_file.seekp(static_cast<std::streamoff>(slot) * page_size);
+    page_file.write(reinterpret_cast<const char *>(page_data), page_size);
+    page_file.flush();
+    return page_file.good();
+}
+
+bool FileBackingStore::read_page(uint32_t slot, uint8_t *page_data)
+{
+    std::lock_guard lock(store_mutex);
+    page_file.clear();
+    page_file.seekg(static_cast<std::streamoff>(slot) * page_size);
+    page_file.read(reinterpret_cast<char*>(page_data), page_size);
+    return page_file.good();
+}
+
+bool FileBackingStore::read_pages(std::span<const uint32_t> slots, std::span<uint8_t* const> pages)
+{
+    // One lock for the whole batch instead of one per page
+    std::lock_guard lock(store_mutex);
+    page_file.clear();
+    for (size_t i = 0; i < slots.size(); i++) {
+        page_file.seekg(static_cast<std::streamoff>(slots[i]) * page_size);
+        page_file.read(reinterpret_cast<char*>(pages[i]), page_size);
+    }
+    return page_file.good();
+}
+
+bool FileBackingStore::write_pages(std::span<const uint32_t> slots, std::span<const uint8_t* const> pages)
+{
+    std::lock_guard lock(store_mutex);
+    page_file.clear();
+    for (size_t i = 0; i < slots.size(); i++) {
+        page_file.seekp(static_cast<std::streamoff>(slots[i]) * page_size);
+        page_file.write(reinterpret_cast<const char *>(pages[i]), page_size);
+    }
+    page_file.flush();
+    return page_file.good();
+}
+
+void FileBackingStore::sync()
+{
+    std::lock_guard lock(store_mutex);
+    page_file.flush();
+}
+
+std::string FileBackingStore::get_name() const
+{
+    return "fstream";
+}
+
+MappedBackingStore::MappedBackingStore(const std::string &file_path, size_t max_pages, uint32_t page_size,
+                                       uint32_t sync_interval) :
+    BackingStore(file_path, max_pages, page_size), mapping_size(max_pages * page_size), sync_interval(sync_interval)
+{
+}
+
+MappedBackingStore::~MappedBackingStore()
+{
+#ifdef _WIN32
+    if (mapping) {
+        FlushViewOfFile(mapping, 0);
+        UnmapViewOfFile(mapping);
+    }
+    if (mapping_handle) CloseHandle(mapping_handle);
+    if (file_handle) CloseHandle(file_handle);
+#else
+    if (mapping) {
+        msync(mapping, mapping_size, MS_SYNC);
+        munmap(mapping, mapping_size);
+    }
+    if (file_descriptor >= 0) close(file_descriptor);
+#endif
+}
+
+bool MappedBackingStore::grow_file(size_t pages)
+{
+#ifdef _WIN32
+    if (mapping) return true;
+
+    HANDLE file = CreateFileA(page_file_path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    file_handle = file;
+
+    // Sizing happens in CreateFileMapping, which grows the file to the requested length
+    const ULARGE_INTEGER size{.QuadPart = mapping_size};
+    HANDLE view_source = CreateFileMappingA(file, nullptr, PAGE_READWRITE, size.HighPart, size.LowPart, nullptr);
+    if (!view_source) return false;
+    mapping_handle = view_source;
+
+    mapping = static_cast<uint8_t*>(MapViewOfFile(view_source, FILE_MAP_ALL_ACCESS, 0, 0, mapping_size));
+    return mapping != nullptr;
+#else
+    if (!mapping) {
+        if (file_descriptor < 0) {
+            file_descriptor = open(page_file_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (file_descriptor < 0) return false;
+        }
+
+        // The view spans max_pages from the start; only the part the file has grown into is touched
+        void* view = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0);
+        if (view == MAP_FAILED) return false;
+        mapping = static_cast<uint8_t*>(view);
+    }
+
+    return ftruncate(file_descriptor, static_cast<off_t>(pages) * page_size) == 0;
+#endif
+}
+
+void MappedBackingStore::punch_hole(uint32_t first, size_t count)
+{
+#ifdef __linux__
+    if (file_descriptor < 0) return;
+
+    fallocate(file_descriptor, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+              static_cast<off_t>(first) * page_size, static_cast<off_t>(count) * page_size);
+#endif
+}
+
+bool MappedBackingStore::write_page(uint32_t slot, const uint8_t *page_data)
+{
+    if (!mapping || slot >= max_pages) return false;
+
+    std::memcpy(mapping + static_cast<size_t>(slot) * page_size, page_data, page_size);
+
+    // Batch flushes: only the write that completes an interval pays for starting one
+    if (sync_interval > 0 &&
+        (writes_since_sync.fetch_add(1, std::memory_order_relaxed) + 1) % sync_interval == 0) {
+        sync();
+    }
+    return true;
+}
+
+bool MappedBackingStore::read_page(uint32_t slot, uint8_t *page_data)
+{
+    if (!mapping || slot >= max_pages) return false;
+
+    std::memcpy(page_data, mapping + static_cast<size_t>(slot) * page_size, page_size);
+    return true;
+}
+
+void MappedBackingStore::sync()
+{
+    if (!mapping) return;
+
+#ifdef _WIN32
+    FlushViewOfFile(mapping, 0);
+#else
+    msync(mapping, mapping_size, MS_ASYNC);
+#endif
+}
+
+std::string MappedBackingStore::get_name() const
+{
+    return "mmap";
+}
+
+std::unique_ptr<BackingStore> create_backing_store(std::string_view name, const std::string &file_path,
+                                                   size_t max_pages, uint32_t page_size, uint32_t sync_interval)
+{
+    std::unique_ptr<BackingStore> store;
+    if (name == "fstream") store = std::make_unique<FileBackingStore>(file_path, max_pages, page_size);
+    else if (name == "mmap") store = std::make_unique<MappedBackingStore>(file_path, max_pages, page_size, sync_interval);
+
+    if (!store || !store->can_open_file()) return nullptr;
+    return store;
+}
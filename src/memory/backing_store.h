@@ -0,0 +1,142 @@
+#ifndef BACKING_STORE_H
+#define BACKING_STORE_H
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Swap space split into page-sized slots. Slot bookkeeping is shared; subclasses decide how page
+// bytes reach the file. Callers own a slot exclusively between allocate_slot and free_slot, so
+// reads and writes of different slots may run in parallel.
+//
+// Nothing touches the disk until the first slot is allocated. The file is then grown one extent at
+// a time as allocation needs more slots, and an extent whose slots are all free again has its disk
+// blocks punched out, so the footprint follows the slots in use rather than max_pages.
+class BackingStore
+{
+    static constexpr size_t EXTENT_BYTES = 64 * 1024;
+
+    // Two-level bitmap: a set bit in used_words marks a slot in use, a set bit in full_words marks a
+    // used_words entry with no free slot left. Padding past max_pages is permanently marked used/full.
+    // Only the first committed_words entries are backed by the file.
+    std::vector<uint64_t> used_words;
+    std::vector<uint64_t> full_words;
+    size_t committed_words = 0;
+    size_t extent_words;
+    size_t next_fit_word = 0;
+    std::mutex slot_mutex;
+
+    // First used_words index in [first, last) that still has a free slot
+    std::optional<size_t> find_free_word(size_t first, size_t last) const;
+
+protected:
+    uint32_t page_size;
+    size_t max_pages;
+    std::string page_file_path;
+
+    // Makes the file hold at least the first `pages` slots, creating it on the first call. Called
+    // with slot_mutex held, so it never runs alongside a transfer to a slot it could disturb.
+    virtual bool grow_file(size_t pages) = 0;
+    // Returns the disk blocks behind `count` slots from `first` to the file system; the slots read
+    // back as zeros. Called with slot_mutex held once every slot in the range is free.
+    virtual void punch_hole(uint32_t, size_t) {}
+
+public:
+    BackingStore(const std::string &file_path, size_t max_pages, uint32_t page_size);
+    virtual ~BackingStore() = default;
+
+    // Whether the page file could be opened for reading and writing, checked without creating or
+    // truncating it: an existing file is opened as it is, otherwise its directory has to exist
+    bool can_open_file() const;
+
+    std::optional<uint32_t> allocate_slot();
+    void free_slot(uint32_t slot);
+
+    virtual bool write_page(uint32_t slot, const uint8_t* page_data) = 0;
+    virtual bool read_page(uint32_t slot, uint8_t* page_data) = 0;
+    // Reads slots[i] into pages[i] for every i, as one batch where the store can do better than a loop
+    virtual bool read_pages(std::span<const uint32_t> slots, std::span<uint8_t* const> pages);
+    // Writes pages[i] to slots[i] for every i, likewise as one batch
+    virtual bool write_pages(std::span<const uint32_t> slots, std::span<const uint8_t* const> pages);
+    // Pushes written pages towards the file; a no-op for stores that write through
+    virtual void sync() {}
+    virtual std::string get_name() const = 0;
+
+    size_t get_extent_pages() const { return extent_words * 64; }
+};
+
+// Seeks and copies through one std::fstream, so every page transfer is serialized on store_mutex
+class FileBackingStore : public BackingStore
+{
+    std::fstream page_file;
+    std::mutex store_mutex;
+#ifdef __linux__
+    // std::fstream has no descriptor to punch holes through, so the file is opened a second time
+    int hole_descriptor = -1;
+#endif
+
+protected:
+    bool grow_file(size_t pages) override;
+    void punch_hole(uint32_t first, size_t count) override;
+
+public:
+    FileBackingStore(const std::string &file_path, size_t max_pages, uint32_t page_size);
+    ~FileBackingStore() override;
+
+    bool write_page(uint32_t slot, const uint8_t* page_data) override;
+    bool read_page(uint32_t slot, uint8_t* page_data) override;
+    bool read_pages(std::span<const uint32_t> slots, std::span<uint8_t* const> pages) override;
+    bool write_pages(std::span<const uint32_t> slots, std::span<const uint8_t* const> pages) override;
+    void sync() override;
+    std::string get_name() const override;
+};
+
+// Maps the whole page file and memcpys slots in and out without a lock. With a non-zero
+// sync_interval, an asynchronous flush of the mapping is started every sync_interval page-outs;
+// with 0 the OS writes dirty pages back on its own schedule. The destructor always flushes.
+//
+// On POSIX the mapping reserves room for max_pages up front and the file behind it is extended
+// with ftruncate as extents are added. Windows cannot grow a file under a view, so there the file
+// is created at full size, but still only on the first page-out.
+class MappedBackingStore : public BackingStore
+{
+    uint8_t* mapping = nullptr;
+    size_t mapping_size = 0;
+    uint32_t sync_interval;
+    std::atomic<uint64_t> writes_since_sync{0};
+
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#else
+    int file_descriptor = -1;
+#endif
+
+protected:
+    bool grow_file(size_t pages) override;
+    void punch_hole(uint32_t first, size_t count) override;
+
+public:
+    MappedBackingStore(const std::string &file_path, size_t max_pages, uint32_t page_size, uint32_t sync_interval);
+    ~MappedBackingStore() override;
+
+    bool write_page(uint32_t slot, const uint8_t* page_data) override;
+    bool read_page(uint32_t slot, uint8_t* page_data) override;
+    void sync() override;
+    std::string get_name() const override;
+};
+
+// Returns nullptr for an unknown name, or when can_open_file fails. Names match the backing-store
+// config values. The file is still only created on the first page-out; should that fail anyway,
+// the store reports it as running out of slots.
+std::unique_ptr<BackingStore> create_backing_store(std::string_view name, const std::string &file_path,
+                                                   size_t max_pages, uint32_t page_size, uint32_t sync_interval);
+
+#endif //BACKING_STORE_H
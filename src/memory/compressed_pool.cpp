@@ -0,0 +1,180 @@
+#include "compressed_pool.h"
+#include <algorithm>
+#include <cstring>
+
+std::vector<uint8_t> CompressedPool::compress(std::span<const uint8_t> page)
+{
+    constexpr size_t MIN_RUN = 3;
+    constexpr size_t MAX_RUN = 130;
+    constexpr size_t MAX_LITERALS = 128;
+
+    std::vector<uint8_t> out;
+    out.reserve(page.size() / 4);
+    size_t literal_start = 0;
+    size_t i = 0;
+
+    auto flush_literals = [&](size_t end) {
+        while (literal_start < end) {
+            const size_t count = std::min(end - literal_start, MAX_LITERALS);
+            out.push_back(static_cast<uint8_t>(count - 1));
+            out.insert(out.end(), page.begin() + literal_start, page.begin() + literal_start + count);
+            literal_start += count;
+        }
+    };
+
+    while (i < page.size()) {
+        size_t run = 1;
+        while (i + run < page.size() && run < MAX_RUN && page[i + run] == page[i]) run++;
+
+        if (run >= MIN_RUN) {
+            flush_literals(i);
+            out.push_back(static_cast<uint8_t>(run + 125));
+            out.push_back(page[i]);
+            i += run;
+            literal_start = i;
+        } else {
+            i += run;
+        }
+    }
+    flush_literals(page.size());
+    return out;
+}
+
+void CompressedPool::decompress(std::span<const uint8_t> data, std::span<uint8_t> page)
+{
+    size_t in = 0;
+    size_t out = 0;
+    while (in < data.size() && out < page.size()) {
+        const uint8_t control = data[in++];
+        if (control < 128) {
+            const size_t count = std::min<size_t>(control + 1, page.size() - out);
+            std::memcpy(page.data() + out, data.data() + in, count);
+            in += control + 1;
+            out += count;
+        } else {
+            const size_t count = std::min<size_t>(control - 125, page.size() - out);
+            std::memset(page.data() + out, data[in++], count);
+            out += count;
+        }
+    }
+}
+
+void CompressedPool::erase_locked(uint32_t slot)
+{
+    const auto it = entries.find(slot);
+    if (it == entries.end()) return;
+
+    used_bytes -= it->second.data.size();
+    oldest_first.erase(it->second.age);
+    entries.erase(it);
+}
+
+void CompressedPool::wait_for_spill(std::unique_lock<std::mutex> &lock, uint32_t slot)
+{
+    spill_done.wait(lock, [this, slot] {
+        const auto it = entries.find(slot);
+        return it == entries.end() || !it->second.spilling;
+    });
+}
+
+bool CompressedPool::store(uint32_t slot, std::span<const uint8_t> page, BackingStore &spill_to)
+{
+    // Compress outside the lock; only the bookkeeping is shared
+    auto data = compress(page);
+    const bool fits = data.size() < page.size() && data.size() <= capacity_bytes;
+
+    std::unique_lock lock(pool_mutex);
+    wait_for_spill(lock, slot);
+    erase_locked(slot);
+
+    if (!fits) {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Claim the oldest entries no other store is spilling until the new page would fit
+    std::vector<uint32_t> victims;
+    for (auto it = oldest_first.begin();
+         it != oldest_first.end() && used_bytes - spilling_bytes + data.size() > capacity_bytes; ++it) {
+        Entry& entry = entries.at(*it);
+        if (entry.spilling) continue;
+        entry.spilling = true;
+        spilling_bytes += entry.data.size();
+        victims.push_back(*it);
+    }
+
+    if (!victims.empty()) {
+        // A spilling entry is neither erased nor replaced, so its data can be read unlocked
+        std::vector<const Entry*> victim_entries;
+        for (uint32_t victim : victims) victim_entries.push_back(&entries.at(victim));
+        lock.unlock();
+
+        std::vector<uint8_t> spill_page(page_size);
+        std::vector<bool> written(victims.size());
+        for (size_t i = 0; i < victims.size(); i++) {
+            decompress(victim_entries[i]->data, spill_page);
+            written[i] = spill_to.write_page(victims[i], spill_page.data());
+        }
+
+        lock.lock();
+        for (size_t i = 0; i < victims.size(); i++) {
+            Entry& entry = entries.at(victims[i]);
+            entry.spilling = false;
+            spilling_bytes -= entry.data.size();
+            if (written[i]) {
+                erase_locked(victims[i]);
+                spilled.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        spill_done.notify_all();
+    }
+
+    // Failed spills, or other stores filling the room meanwhile, leave the page to the caller
+    if (used_bytes + data.size() > capacity_bytes) return false;
+
+    used_bytes += data.size();
+    oldest_first.push_back(slot);
+    entries.emplace(slot, Entry{std::move(data), std::prev(oldest_first.end())});
+    return true;
+}
+
+bool CompressedPool::load(uint32_t slot, std::span<uint8_t> page)
+{
+    std::lock_guard lock(pool_mutex);
+    const auto it = entries.find(slot);
+    if (it == entries.end()) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    decompress(it->second.data, page);
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void CompressedPool::erase(uint32_t slot)
+{
+    std::unique_lock lock(pool_mutex);
+    wait_for_spill(lock, slot);
+    erase_locked(slot);
+}
+
+bool CompressedPool::contains(uint32_t slot)
+{
+    std::lock_guard lock(pool_mutex);
+    return entries.contains(slot);
+}
+
+CompressedPoolStats CompressedPool::get_stats()
+{
+    std::lock_guard lock(pool_mutex);
+    return {
+        .hits = hits.load(std::memory_order_relaxed),
+        .misses = misses.load(std::memory_order_relaxed),
+        .spilled = spilled.load(std::memory_order_relaxed),
+        .rejected = rejected.load(std::memory_order_relaxed),
+        .stored_pages = entries.size(),
+        .original_bytes = entries.size() * page_size,
+        .compressed_bytes = used_bytes,
+    };
+}
@@ -0,0 +1,79 @@
+#ifndef COMPRESSED_POOL_H
+#define COMPRESSED_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "backing_store.h"
+
+struct CompressedPoolStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t spilled = 0;      // pages pushed out to the backing store to make room
+    uint64_t rejected = 0;     // pages that did not compress and went straight to the backing store
+    size_t stored_pages = 0;
+    size_t original_bytes = 0; // uncompressed size of what the pool currently holds
+    size_t compressed_bytes = 0;
+};
+
+// zswap-style tier in front of a BackingStore: pages are run-length compressed into a bounded pool,
+// keyed by their backing-store slot. When the pool is full the oldest entries spill to their slot
+// in the file. Entries stay after a load, so a clean page evicted again needs no new store.
+//
+// Spills are written without pool_mutex held. The entries being spilled stay in the pool, and
+// loadable, until their write has succeeded; one whose write fails is kept.
+class CompressedPool
+{
+    struct Entry
+    {
+        std::vector<uint8_t> data;
+        std::list<uint32_t>::iterator age;
+        bool spilling = false;
+    };
+
+    size_t capacity_bytes;
+    uint32_t page_size;
+    size_t used_bytes = 0;
+    size_t spilling_bytes = 0; // part of used_bytes that spills in progress are about to free
+    std::unordered_map<uint32_t, Entry> entries;
+    std::list<uint32_t> oldest_first;
+    std::mutex pool_mutex;
+    // Signalled when a spill finishes. Replacing or erasing an entry waits for its spill, or the
+    // late file write could land on top of whatever the slot holds next.
+    std::condition_variable spill_done;
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> spilled{0};
+    std::atomic<uint64_t> rejected{0};
+
+    void erase_locked(uint32_t slot);
+    void wait_for_spill(std::unique_lock<std::mutex>& lock, uint32_t slot);
+
+public:
+    CompressedPool(size_t capacity_bytes, uint32_t page_size) : capacity_bytes(capacity_bytes), page_size(page_size) {}
+
+    // Returns false when the page does not compress, can never fit, or no room could be made because
+    // spills failed; the caller then writes it to the backing store itself, and any older copy of
+    // the slot in the pool is dropped.
+    bool store(uint32_t slot, std::span<const uint8_t> page, BackingStore& spill_to);
+    // Returns false on a miss, leaving page untouched
+    bool load(uint32_t slot, std::span<uint8_t> page);
+    void erase(uint32_t slot);
+    bool contains(uint32_t slot);
+
+    CompressedPoolStats get_stats();
+
+    // Control byte n < 128: n + 1 literal bytes follow. n >= 128: the next byte repeats n - 125 times.
+    static std::vector<uint8_t> compress(std::span<const uint8_t> page);
+    static void decompress(std::span<const uint8_t> data, std::span<uint8_t> page);
+};
+
+#endif //COMPRESSED_POOL_H
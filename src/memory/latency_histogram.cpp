@@ -0,0 +1,63 @@
+#include "latency_histogram.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+size_t LatencyHistogram::bucket_of(uint64_t nanoseconds)
+{
+    if (nanoseconds < SUB_COUNT) return nanoseconds;
+
+    const uint32_t top_bit = std::bit_width(nanoseconds) - 1;
+    if (top_bit >= MAX_BITS) return NUM_BUCKETS - 1;
+
+    // The SUB_BITS bits below the top one pick the step within this power of two
+    const uint32_t shift = top_bit - SUB_BITS;
+    return ((shift + 1) << SUB_BITS) + (nanoseconds >> shift) - SUB_COUNT;
+}
+
+uint64_t LatencyHistogram::bucket_lower(size_t bucket)
+{
+    if (bucket < SUB_COUNT) return bucket;
+
+    const uint32_t shift = static_cast<uint32_t>(bucket >> SUB_BITS) - 1;
+    return ((bucket & (SUB_COUNT - 1)) + SUB_COUNT) << shift;
+}
+
+uint64_t LatencyHistogram::bucket_upper(size_t bucket)
+{
+    if (bucket + 1 >= NUM_BUCKETS) return UINT64_MAX;
+    return bucket_lower(bucket + 1) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds)
+{
+    buckets[bucket_of(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t seen = max_value.load(std::memory_order_relaxed);
+    while (nanoseconds > seen && !max_value.compare_exchange_weak(seen, nanoseconds, std::memory_order_relaxed)) {}
+}
+
+LatencySnapshot LatencyHistogram::snapshot() const
+{
+    LatencySnapshot result;
+    result.counts.resize(NUM_BUCKETS);
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        result.counts[i] = buckets[i].load(std::memory_order_relaxed);
+        result.total += result.counts[i];
+    }
+    result.max = max_value.load(std::memory_order_relaxed);
+    return result;
+}
+
+uint64_t LatencySnapshot::percentile(double q) const
+{
+    if (total == 0) return 0;
+
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(total))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= rank) return std::min(LatencyHistogram::bucket_upper(i), max);
+    }
+    return max;
+}
@@ -0,0 +1,46 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Point-in-time copy of a LatencyHistogram, for reporting
+struct LatencySnapshot
+{
+    std::vector<uint64_t> counts; // one per bucket
+    uint64_t total = 0;
+    uint64_t max = 0;
+
+    // Upper bound of the bucket holding the q-th quantile (0 < q <= 1), capped at the largest value
+    // seen. 0 when nothing was recorded.
+    uint64_t percentile(double q) const;
+};
+
+// HDR-style histogram of nanosecond latencies. Values below SUB_COUNT get a bucket each; above that,
+// every power of two is split into SUB_COUNT linear steps, so a bucket is never wider than ~6% of
+// the values in it. record() is a couple of relaxed atomic operations and may run on any thread.
+class LatencyHistogram
+{
+public:
+    static constexpr uint32_t SUB_BITS = 4;
+    static constexpr uint32_t SUB_COUNT = 1u << SUB_BITS;
+    // Values of 2^MAX_BITS ns (~68 s) and up all land in the last bucket
+    static constexpr uint32_t MAX_BITS = 36;
+    static constexpr size_t NUM_BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_COUNT;
+
+    static size_t bucket_of(uint64_t nanoseconds);
+    static uint64_t bucket_lower(size_t bucket);
+    static uint64_t bucket_upper(size_t bucket);
+
+    void record(uint64_t nanoseconds);
+    LatencySnapshot snapshot() const;
+
+private:
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets{};
+    std::atomic<uint64_t> max_value{0};
+};
+
+#endif //LATENCY_HISTOGRAM_H
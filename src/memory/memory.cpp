@@ -4,63 +4,415 @@
 
 #include "memory.h"
 #include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+#include "../cpu_tick.h"
 
 
 constexpr size_t INVALID_ADDRESS = -1000;
 
-std::optional<uint32_t> BackingStore::allocate_slot()
+// Core whose TLB this host thread uses; -1 for threads that are not CPU workers (shell, generator)
+thread_local int tlb_core_id = -1;
+
+TLBEntry* TLB::lookup(uint32_t pid, uint32_t page_number)
+{
+    TLBEntry& entry = entries[index(pid, page_number)];
+    if (entry.tag.load(std::memory_order_acquire) != make_tag(pid, page_number)) return nullptr;
+    return &entry;
+}
+
+void TLB::insert(uint32_t pid, uint32_t page_number, uint32_t frame_num, ProcessMemorySpace* space, bool writable)
+{
+    TLBEntry& entry = entries[index(pid, page_number)];
+    entry.frame_num = frame_num;
+    entry.space = space;
+    entry.writable = writable;
+    entry.tag.store(make_tag(pid, page_number), std::memory_order_release);
+}
+
+void TLB::invalidate(uint32_t pid, uint32_t page_number)
+{
+    uint64_t expected = make_tag(pid, page_number);
+    // Fails harmlessly if the owning core already reused the slot for another mapping
+    entries[index(pid, page_number)].tag.compare_exchange_strong(expected, TLBEntry::EMPTY);
+}
+
+void TLB::invalidate_process(uint32_t pid)
+{
+    for (auto& entry : entries) {
+        uint64_t tag = entry.tag.load(std::memory_order_acquire);
+        if (tag != TLBEntry::EMPTY && (tag >> 32) == pid) {
+            entry.tag.compare_exchange_strong(tag, TLBEntry::EMPTY);
+        }
+    }
+}
+
+void Memory::bind_current_thread_to_core(uint16_t core_id)
 {
-    std::lock_guard lock(store_mutex);
-    for (size_t i = 0; i < allocated_slots.size(); i++) {
-        if (!allocated_slots[i]) {
-            allocated_slots[i] = true;
+    tlb_core_id = core_id;
+}
+
+TLB* Memory::current_tlb() const
+{
+    if (tlb_core_id < 0 || static_cast<size_t>(tlb_core_id) >= tlbs.size()) return nullptr;
+    return tlbs[tlb_core_id].get();
+}
+
+void Memory::shootdown(uint32_t pid, uint32_t page_number)
+{
+    for (auto& tlb : tlbs) {
+        tlb->invalidate(pid, page_number);
+    }
+}
+
+ProcessMemorySpace* Memory::find_space(uint32_t pid) const
+{
+    const auto it = process_spaces.find(pid);
+    if (it == process_spaces.end()) return nullptr;
+    return it->second.get();
+}
+
+// Gives the replacement policy a view of the frame table for one victim search. Runs under
+// frame_mutex, so locking another process's space here cannot deadlock (same gate as eviction).
+class Memory::FrameScan : public FrameInspector
+{
+    Memory& memory;
+    uint32_t faulting_pid;
+
+    template <typename F>
+    auto with_page(uint32_t frame, F&& visit) -> decltype(visit(std::declval<PageTableEntry&>()))
+    {
+        // A shared frame is visited through every mapping of it that is currently present
+        if (SharedPage* shared = memory.frames[frame].shared) {
+            decltype(visit(std::declval<PageTableEntry&>())) result{};
+            for (const auto& [pid, page_number] : shared->mappers) {
+                ProcessMemorySpace* process_space = memory.find_space(pid);
+                if (!process_space) continue;
+
+                std::unique_lock<std::mutex> owner_lock;
+                if (pid != faulting_pid) {
+                    owner_lock = std::unique_lock(process_space->space_mutex);
+                }
+
+                auto& page_entry = process_space->page_table[page_number];
+                if (page_entry.is_present() && page_entry.frame_num == frame) {
+                    result |= visit(page_entry);
+                }
+            }
+            return result;
+        }
+
+        ProcessMemorySpace* process_space = memory.find_space(memory.frames[frame].pid);
+        if (!process_space) return {};
+
+        // The faulting process already holds its own space lock
+        std::unique_lock<std::mutex> owner_lock;
+        if (memory.frames[frame].pid != faulting_pid) {
+            owner_lock = std::unique_lock(process_space->space_mutex);
+        }
+
+        return visit(process_space->page_table[memory.frames[frame].page_number]);
+    }
+
+public:
+    FrameScan(Memory& memory, uint32_t faulting_pid) : memory(memory), faulting_pid(faulting_pid) {}
+
+    size_t frame_count() const override { return memory.frames.size(); }
+    bool is_free(uint32_t frame) const override { return memory.frames[frame].is_free; }
+
+    bool is_dirty(uint32_t frame) override
+    {
+        return with_page(frame, [](PageTableEntry& page_entry) { return page_entry.is_dirty(); });
+    }
+
+    bool test_and_clear_referenced(uint32_t frame) override
+    {
+        return with_page(frame, [](PageTableEntry& page_entry) {
+            const bool referenced = page_entry.is_referenced();
+            page_entry.set_referenced(false);
+            return referenced;
+        });
+    }
+};
+
+uint32_t Memory::find_victim_frame(uint32_t faulting_pid)
+{
+    FrameScan scan(*this, faulting_pid);
+    if (auto victim = replacement_policy->pick_victim(scan, get_cpu_tick())) {
+        return *victim;
+    }
+
+    for (size_t i = 0; i < frames.size(); i++) {
+        if (!frames[i].is_free) {
             return static_cast<uint32_t>(i);
         }
     }
-    return std::nullopt;
+    return 0;
 }
 
-void BackingStore::free_slot(uint32_t slot)
+bool Memory::set_replacement_policy(std::string_view name, uint64_t working_set_window)
 {
-    std::lock_guard lock(store_mutex);
-    if (slot < allocated_slots.size()) {
-        allocated_slots[slot] = false;
+    auto policy = create_replacement_policy(name, frames.size(), working_set_window);
+    if (!policy) return false;
+
+    std::lock_guard lock(frame_mutex);
+
+    // Let the new policy know about frames that are already resident
+    const uint64_t tick = get_cpu_tick();
+    for (size_t i = 0; i < frames.size(); i++) {
+        if (!frames[i].is_free) {
+            policy->on_allocate(static_cast<uint32_t>(i), tick);
+        }
     }
+
+    replacement_policy = std::move(policy);
+    return true;
 }
 
-bool BackingStore::write_page(uint32_t slot, const uint8_t *page_data)
+std::string Memory::get_replacement_policy_name() const
 {
-    std::lock_guard lock(store_mutex);
-    page_file.seekp(slot * page_size);
-    page_file.write(reinterpret_cast<const char *>(page_data), page_size);
-    return page_file.good();
+    std::lock_guard lock(frame_mutex);
+    return replacement_policy->get_name();
 }
 
-bool BackingStore::read_page(uint32_t slot, uint8_t *page_data)
+bool Memory::set_backing_store(std::string_view name, uint32_t sync_interval)
 {
-    std::lock_guard lock(store_mutex);
-    page_file.seekg(slot * page_size);
-    page_file.read(reinterpret_cast<char*>(page_data), page_size);
-    return page_file.good();
+    std::unique_lock spaces_lock(spaces_mutex);
+    std::lock_guard lock(frame_mutex);
+
+    if (!process_spaces.empty()) return false;
+
+    // Both stores open the same page file, so the old one has to let go of it first. The I/O pool
+    // holds a reference to the store and follows it.
+    if (async_io) flush_page_writes();
+    async_io.reset();
+    backing_store.reset();
+    backing_store = create_backing_store(name, BACKING_STORE_PATH, BACKING_STORE_SLOTS, page_size, sync_interval);
+    const bool created = backing_store != nullptr;
+    if (!created) {
+        backing_store = std::make_unique<FileBackingStore>(BACKING_STORE_PATH, BACKING_STORE_SLOTS, page_size);
+    }
+
+    if (io_threads > 0) {
+        async_io = std::make_unique<AsyncPageIO>(*backing_store, io_threads);
+    }
+    return created;
 }
 
-uint32_t Memory::find_victim_frame()
+bool Memory::set_backing_store(std::unique_ptr<BackingStore> store)
 {
-    if (replacement_queue.empty()) {
-        for (size_t i = 0; i < frames.size(); i++) {
-            if (!frames[i].is_free) {
-                return static_cast<uint32_t>(i);
+    std::unique_lock spaces_lock(spaces_mutex);
+    std::lock_guard lock(frame_mutex);
+
+    if (!process_spaces.empty()) return false;
+
+    if (async_io) flush_page_writes();
+    async_io.reset();
+    backing_store = std::move(store);
+    if (io_threads > 0) {
+        async_io = std::make_unique<AsyncPageIO>(*backing_store, io_threads);
+    }
+    return true;
+}
+
+bool Memory::set_io_threads(unsigned threads)
+{
+    std::unique_lock spaces_lock(spaces_mutex);
+    std::lock_guard lock(frame_mutex);
+
+    if (!process_spaces.empty()) return false;
+
+    if (async_io) flush_page_writes();
+    async_io.reset();
+    io_threads = threads;
+    if (io_threads > 0) {
+        async_io = std::make_unique<AsyncPageIO>(*backing_store, io_threads);
+    }
+    return true;
+}
+
+std::string Memory::get_backing_store_name() const
+{
+    std::lock_guard lock(frame_mutex);
+    return backing_store->get_name();
+}
+
+bool Memory::set_compressed_pool(size_t capacity_bytes)
+{
+    std::unique_lock spaces_lock(spaces_mutex);
+    std::lock_guard lock(frame_mutex);
+
+    // Pool entries are the only copy of their page, so the pool cannot change under live processes
+    if (!process_spaces.empty()) return false;
+
+    compressed_pool.reset();
+    if (capacity_bytes > 0) {
+        compressed_pool = std::make_unique<CompressedPool>(capacity_bytes, page_size);
+    }
+    return true;
+}
+
+std::optional<CompressedPoolStats> Memory::get_compressed_pool_stats() const
+{
+    if (!compressed_pool) return std::nullopt;
+    return compressed_pool->get_stats();
+}
+
+void Memory::wait_for_slot(std::unique_lock<std::mutex> &lock, uint32_t slot)
+{
+    const auto pending = slots_in_flight.find(slot);
+    if (pending == slots_in_flight.end() || !pending->second.submitted) return;
+
+    ++inflight_write_waits;
+    inflight_cv.wait(lock, [this, slot] {
+        const auto it = slots_in_flight.find(slot);
+        return it == slots_in_flight.end() || !it->second.submitted;
+    });
+}
+
+void Memory::flush_page_writes()
+{
+    std::vector<uint32_t> slots;
+    std::vector<PageIORequest> requests;
+    {
+        std::lock_guard lock(inflight_mutex);
+        slots.swap(queued_writes);
+        for (uint32_t slot : slots) {
+            auto& pending = slots_in_flight.at(slot);
+            pending.submitted = true;
+            requests.push_back({slot, pending.copy->data()});
+        }
+    }
+    if (slots.empty()) return;
+
+    // The copies stay in slots_in_flight until their page is on disk. A failed batch is retried a
+    // page at a time; a page that still fails goes back in the queue for the next flush, its copy
+    // serving reads meanwhile, so the only copy of a page is never dropped.
+    std::vector<const uint8_t*> copies;
+    for (const auto& request : requests) copies.push_back(request.data);
+
+    async_io->submit_writes(std::move(requests), [this, slots = std::move(slots), copies = std::move(copies)](bool ok) {
+        std::vector<bool> written(slots.size(), ok);
+        if (!ok) {
+            for (size_t i = 0; i < slots.size(); i++) {
+                written[i] = backing_store->write_page(slots[i], copies[i]);
             }
         }
-        return 0;
+
+        {
+            std::lock_guard lock(inflight_mutex);
+            for (size_t i = 0; i < slots.size(); i++) {
+                if (written[i]) {
+                    slots_in_flight.erase(slots[i]);
+                } else {
+                    slots_in_flight.at(slots[i]).submitted = false;
+                    queued_writes.push_back(slots[i]);
+                }
+            }
+        }
+        inflight_cv.notify_all();
+    });
+}
+
+bool Memory::store_page(uint32_t slot, const uint8_t *page_data)
+{
+    if (async_io) {
+        // Once a running write of the slot has landed, a queued one just takes the new contents
+        std::unique_lock lock(inflight_mutex);
+        wait_for_slot(lock, slot);
+        const auto pending = slots_in_flight.find(slot);
+        if (pending != slots_in_flight.end()) {
+            std::memcpy(pending->second.copy->data(), page_data, page_size);
+            ++coalesced_page_writes;
+            return true;
+        }
     }
 
-    uint32_t victim_frame = replacement_queue.front();
-    replacement_queue.pop();
-    return victim_frame;
+    if (compressed_pool && compressed_pool->store(slot, {page_data, page_size}, *backing_store)) return true;
+    if (!async_io) return backing_store->write_page(slot, page_data);
+
+    // The frame is reused as soon as this returns, so the write works from a copy
+    bool batch_full;
+    {
+        std::lock_guard lock(inflight_mutex);
+        slots_in_flight.emplace(slot, InFlightWrite{std::make_unique<std::vector<uint8_t>>(page_data, page_data + page_size)});
+        queued_writes.push_back(slot);
+        batch_full = queued_writes.size() >= WRITE_BATCH_PAGES;
+    }
+    ++async_page_writes;
+
+    if (batch_full) flush_page_writes();
+    return true;
 }
 
-std::optional<uint32_t> Memory::allocate_frame()
+bool Memory::store_pages(std::span<const uint32_t> slots, std::span<const uint8_t* const> pages)
+{
+    bool ok = true;
+
+    // Write-behind already batches; flushing hands this batch over right away
+    if (async_io) {
+        for (size_t i = 0; i < slots.size(); i++) {
+            ok &= store_page(slots[i], pages[i]);
+        }
+        flush_page_writes();
+        return ok;
+    }
+
+    std::vector<size_t> to_file;
+    to_file.reserve(slots.size());
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (compressed_pool && compressed_pool->store(slots[i], {pages[i], page_size}, *backing_store)) continue;
+        to_file.push_back(i);
+    }
+    std::ranges::sort(to_file, {}, [slots](size_t i) { return slots[i]; });
+
+    std::vector<uint32_t> file_slots;
+    std::vector<const uint8_t*> file_pages;
+    file_slots.reserve(to_file.size());
+    file_pages.reserve(to_file.size());
+    for (size_t i : to_file) {
+        file_slots.push_back(slots[i]);
+        file_pages.push_back(pages[i]);
+    }
+    return backing_store->write_pages(file_slots, file_pages) && ok;
+}
+
+bool Memory::load_page_from_memory(uint32_t slot, uint8_t *page_data)
+{
+    // A page faulted back in before its write-out finished is still in the write's copy
+    if (async_io) {
+        std::lock_guard lock(inflight_mutex);
+        if (auto pending = slots_in_flight.find(slot); pending != slots_in_flight.end()) {
+            std::memcpy(page_data, pending->second.copy->data(), page_size);
+            ++inflight_read_hits;
+            return true;
+        }
+    }
+
+    return compressed_pool && compressed_pool->load(slot, {page_data, page_size});
+}
+
+bool Memory::load_page(uint32_t slot, uint8_t *page_data)
+{
+    if (load_page_from_memory(slot, page_data)) return true;
+    return backing_store->read_page(slot, page_data);
+}
+
+void Memory::release_slot(uint32_t slot)
+{
+    // A slot must not be handed out again while an old write to it can still land. A write that
+    // has not started is dropped instead, since nobody will read the slot again.
+    if (async_io) {
+        std::unique_lock lock(inflight_mutex);
+        wait_for_slot(lock, slot);
+        if (slots_in_flight.erase(slot) > 0) std::erase(queued_writes, slot);
+    }
+    if (compressed_pool) compressed_pool->erase(slot);
+    backing_store->free_slot(slot);
+}
+
+std::optional<uint32_t> Memory::allocate_frame(uint32_t faulting_pid)
 {
     if (!free_frames.empty()) {
         uint32_t frame = free_frames.front();
@@ -68,64 +420,365 @@ std::optional<uint32_t> Memory::allocate_frame()
         frames[frame].is_free = false;
         frames[frame].allocation_order = allocation_counter++;
 
-        replacement_queue.push(frame);
+        replacement_policy->on_allocate(frame, get_cpu_tick());
+
+        if (free_frames.size() < low_watermark_frames) {
+            wake_reclaim_daemon();
+        }
 
         return frame;
     }
 
-    return evict_and_allocate();
+    wake_reclaim_daemon();
+    return evict_and_allocate(faulting_pid);
 }
 
-std::optional<uint32_t> Memory::evict_and_allocate()
+bool Memory::evict_frame(uint32_t victim_frame, uint32_t faulting_pid)
 {
-    uint32_t victim_frame = find_victim_frame();
+    const auto evict_start = latency_start();
+    auto record_eviction = [&] {
+        if (evict_start == std::chrono::steady_clock::time_point{}) return;
+        record_latency(faulting_pid != NO_PID ? find_space(faulting_pid) : nullptr, FaultKind::eEviction, evict_start);
+    };
+
+    if (frames[victim_frame].shared) {
+        evict_shared_frame(victim_frame, faulting_pid);
+        record_eviction();
+        return true;
+    }
 
     uint32_t victim_process = frames[victim_frame].pid;
     uint32_t victim_page = frames[victim_frame].page_number;
 
-    auto& process_space = process_spaces[victim_process];
-    auto& page_entry = process_space->page_table[victim_page];
-
-    if (page_entry.is_dirty()) {
-        if (process_space->page_to_backing_slot.find(victim_page) == process_space->page_to_backing_slot.end()) {
-            auto slot = backing_store->allocate_slot();
-            if (!slot) return std::nullopt;
-            process_space->page_to_backing_slot[victim_page] = *slot;
-        }
+    ProcessMemorySpace* process_space = find_space(victim_process);
+    if (!process_space) return false;
 
-        uint32_t physical_addr = get_physical_address(victim_frame, 0);
-        backing_store->write_page(
-            process_space->page_to_backing_slot[victim_page],
-            &memory[physical_addr]
-            );
-        ++page_swaps;
+    // The faulting process already holds its own space lock. Any other owner can only be sitting on the
+    // resident fast path, which never waits on frame_mutex, so this cannot deadlock.
+    std::unique_lock<std::mutex> victim_lock;
+    if (victim_process != faulting_pid) {
+        victim_lock = std::unique_lock(process_space->space_mutex);
+    }
 
-        // increment page-out counter
-        pages_paged_out.fetch_add(1);
+    auto& page_entry = process_space->page_table[victim_page];
 
+    if (page_entry.is_dirty()) {
+        if (!write_back_page(*process_space, victim_page, victim_frame)) return false;
     }
 
+    // A page used since the last sample still counts toward the working set once it is gone
+    process_space->sample_access(victim_page, get_cpu_tick());
     page_entry.set_present(false);
     page_entry.set_dirty(false);
+    page_entry.set_readahead(false);
+    shootdown(victim_process, victim_page);
 
+    unassign_frame(victim_frame, *process_space);
     process_space->allocated_pages--;
+    ++evictions;
+
+    record_eviction();
+    return true;
+}
+
+void Memory::assign_frame(uint32_t frame, ProcessMemorySpace& owner, uint32_t page_number)
+{
+    frames[frame].pid = owner.process_id;
+    frames[frame].page_number = page_number;
+
+    frames[frame].owner_prev = Frame::NONE;
+    frames[frame].owner_next = owner.owned_frames_head;
+    if (owner.owned_frames_head != Frame::NONE) {
+        frames[owner.owned_frames_head].owner_prev = frame;
+    }
+    owner.owned_frames_head = frame;
+}
+
+void Memory::unassign_frame(uint32_t frame, ProcessMemorySpace& owner)
+{
+    const uint32_t prev = frames[frame].owner_prev;
+    const uint32_t next = frames[frame].owner_next;
+
+    if (prev != Frame::NONE) frames[prev].owner_next = next;
+    else owner.owned_frames_head = next;
+    if (next != Frame::NONE) frames[next].owner_prev = prev;
+
+    frames[frame].owner_prev = Frame::NONE;
+    frames[frame].owner_next = Frame::NONE;
+}
+
+void Memory::release_frame(uint32_t frame)
+{
+    frames[frame].is_free = true;
+    frames[frame].shared = nullptr;
+    free_frames.push(frame);
+    replacement_policy->on_free(frame);
+}
+
+bool Memory::write_back_page(ProcessMemorySpace& process_space, uint32_t page_number, uint32_t frame)
+{
+    if (process_space.page_to_backing_slot.find(page_number) == process_space.page_to_backing_slot.end()) {
+        auto slot = backing_store->allocate_slot();
+        if (!slot) return false;
+        process_space.page_to_backing_slot[page_number] = *slot;
+    }
+
+    // On failure the caller keeps the frame and its dirty bit; the slot stays for the next attempt
+    uint32_t physical_addr = get_physical_address(frame, 0);
+    if (!store_page(process_space.page_to_backing_slot[page_number], &memory[physical_addr])) return false;
+    ++page_swaps;
+
+    // increment page-out counter
+    pages_paged_out.fetch_add(1);
+
+    return true;
+}
+
+std::optional<uint32_t> Memory::evict_and_allocate(uint32_t faulting_pid)
+{
+    uint32_t victim_frame = find_victim_frame(faulting_pid);
+    if (!evict_frame(victim_frame, faulting_pid)) return std::nullopt;
 
     frames[victim_frame].is_free = false;
     frames[victim_frame].allocation_order = allocation_counter++;
-    replacement_queue.push(victim_frame);
+    ++direct_reclaims;
+
+    replacement_policy->on_free(victim_frame);
+    replacement_policy->on_allocate(victim_frame, get_cpu_tick());
 
     return victim_frame;
 }
 
-bool Memory::handle_page_fault(uint32_t pid, uint32_t page_number)
+void Memory::start_reclaim_daemon(uint32_t low_watermark_percent, uint32_t high_watermark_percent)
 {
-    auto it = process_spaces.find(pid);
-    if (it == process_spaces.end()) {
-        return false;
+    stop_reclaim_daemon();
+    if (low_watermark_percent == 0) return;
+
+    {
+        std::lock_guard lock(frame_mutex);
+        low_watermark_frames = std::max<size_t>(1, frames.size() * low_watermark_percent / 100);
+        high_watermark_frames = std::max(low_watermark_frames,
+                                         std::min(frames.size(), frames.size() * high_watermark_percent / 100));
+    }
+
+    std::lock_guard lock(reclaim_mutex);
+    reclaim_running = true;
+    reclaim_thread = std::thread(&Memory::reclaim_worker, this);
+}
+
+void Memory::stop_reclaim_daemon()
+{
+    {
+        std::lock_guard lock(reclaim_mutex);
+        if (!reclaim_running) return;
+        reclaim_running = false;
+    }
+    reclaim_cv.notify_one();
+    reclaim_thread.join();
+
+    std::lock_guard lock(frame_mutex);
+    low_watermark_frames = 0;
+    high_watermark_frames = 0;
+}
+
+void Memory::start_io_worker()
+{
+    std::lock_guard lock(io_mutex);
+    if (io_running) return;
+
+    io_running = true;
+    io_thread = std::thread(&Memory::io_worker, this);
+}
+
+void Memory::stop_io_worker()
+{
+    {
+        std::lock_guard lock(io_mutex);
+        if (!io_running) return;
+        io_running = false;
+        io_queue.clear();
+    }
+    io_cv.notify_all();
+    io_thread.join();
+}
+
+bool Memory::needs_page_in(const ProcessMemorySpace& process_space, uint32_t page_number) const
+{
+    const PageTableEntry* page_entry = process_space.page_table.find(page_number);
+    if (page_entry && page_entry->is_present()) return false;
+
+    // A shared page may be resident for another process, but usually is not when this one faults
+    if (process_space.page_to_shared.contains(page_number)) return true;
+
+    const auto slot = process_space.page_to_backing_slot.find(page_number);
+    if (slot == process_space.page_to_backing_slot.end()) return false;
+
+    return !(compressed_pool && compressed_pool->contains(slot->second));
+}
+
+bool Memory::request_page_in(uint32_t pid, std::span<const uint32_t> virtual_addresses, std::function<void()> on_ready)
+{
+    if (!io_running.load(std::memory_order_relaxed)) return false;
+
+    std::vector<uint32_t> pages;
+    {
+        std::shared_lock spaces_lock(spaces_mutex);
+
+        ProcessMemorySpace* process_space = find_space(pid);
+        if (!process_space) return false;
+
+        std::lock_guard space_lock(process_space->space_mutex);
+        for (uint32_t address : virtual_addresses) {
+            const uint32_t page_number = get_page_number(address);
+            if (needs_page_in(*process_space, page_number) && std::ranges::find(pages, page_number) == pages.end()) {
+                pages.push_back(page_number);
+            }
+        }
+    }
+    if (pages.empty()) return false;
+
+    {
+        std::lock_guard lock(io_mutex);
+        if (!io_running) return false;
+        io_queue.push_back({pid, std::move(pages), std::move(on_ready)});
+    }
+    io_cv.notify_all();
+    return true;
+}
+
+void Memory::io_worker()
+{
+    while (true) {
+        PageInRequest request;
+        {
+            std::unique_lock lock(io_mutex);
+            io_cv.wait(lock, [this] { return !io_queue.empty() || !io_running; });
+            if (!io_running) return;
+
+            request = std::move(io_queue.front());
+            io_queue.pop_front();
+            io_in_flight_pid = request.pid;
+        }
+
+        // Ordinary faults, just taken on this thread instead of the requester's core
+        for (uint32_t page_number : request.pages) {
+            std::shared_lock spaces_lock(spaces_mutex);
+            std::unique_lock<std::mutex> space_lock;
+            uint32_t frame_num = 0;
+            if (translate(request.pid, page_number, space_lock, frame_num, false)) {
+                ++async_page_ins;
+            }
+        }
+
+        // Outside io_mutex; io_in_flight_pid still holds off destroy_process_space until it returns
+        request.on_ready();
+        {
+            std::lock_guard lock(io_mutex);
+            io_in_flight_pid = NO_PID;
+        }
+        io_cv.notify_all();
+    }
+}
+
+void Memory::wake_reclaim_daemon()
+{
+    {
+        std::lock_guard lock(reclaim_mutex);
+        if (!reclaim_running) return;
+        reclaim_wanted = true;
+    }
+    reclaim_cv.notify_one();
+}
+
+void Memory::reclaim_worker()
+{
+    while (true) {
+        {
+            std::unique_lock lock(reclaim_mutex);
+            reclaim_cv.wait_for(lock, RECLAIM_PERIOD, [this] { return reclaim_wanted || !reclaim_running; });
+            if (!reclaim_running) return;
+            reclaim_wanted = false;
+        }
+
+        std::shared_lock spaces_lock(spaces_mutex);
+
+        size_t shortfall;
+        {
+            std::lock_guard frame_lock(frame_mutex);
+            if (free_frames.size() >= low_watermark_frames) continue;
+            shortfall = high_watermark_frames - free_frames.size();
+        }
+
+        // Write-back happens here, outside frame_mutex, so foreground faults keep running meanwhile
+        preclean_pages(shortfall);
+
+        // One eviction per hold of frame_mutex, so a foreground fault never waits behind the whole batch
+        while (true) {
+            std::lock_guard frame_lock(frame_mutex);
+            if (free_frames.size() >= high_watermark_frames) break;
+
+            uint32_t victim_frame = find_victim_frame(NO_PID);
+            if (frames[victim_frame].is_free || !evict_frame(victim_frame, NO_PID)) break;
+
+            frames[victim_frame].is_free = true;
+            free_frames.push(victim_frame);
+            replacement_policy->on_free(victim_frame);
+            ++background_reclaims;
+        }
+
+        // Write-behind is flushed on every pass, so page-outs never sit queued for long
+        if (async_io) flush_page_writes();
+    }
+}
+
+void Memory::preclean_pages(size_t max_pages)
+{
+    struct Candidate
+    {
+        uint32_t frame;
+        uint32_t pid;
+        uint32_t page_number;
+    };
+
+    std::vector<Candidate> candidates;
+    {
+        std::lock_guard frame_lock(frame_mutex);
+        for (size_t step = 0; step < frames.size(); step++) {
+            const uint32_t frame = static_cast<uint32_t>((preclean_cursor + step) % frames.size());
+            if (!frames[frame].is_free && !frames[frame].shared) {
+                candidates.push_back({frame, frames[frame].pid, frames[frame].page_number});
+            }
+        }
+        preclean_cursor = (preclean_cursor + max_pages) % frames.size();
     }
 
-    auto& process_space = it->second;
+    size_t cleaned = 0;
+    for (const auto& candidate : candidates) {
+        if (cleaned >= max_pages) break;
+
+        ProcessMemorySpace* process_space = find_space(candidate.pid);
+        if (!process_space) continue;
 
+        std::lock_guard space_lock(process_space->space_mutex);
+
+        // The frame may have been evicted or reused since it was sampled
+        if (candidate.page_number >= process_space->page_table.size()) continue;
+        auto& page_entry = process_space->page_table[candidate.page_number];
+        if (!page_entry.is_present() || page_entry.frame_num != candidate.frame) continue;
+
+        // Recently used pages are likely to be dirtied again, so leave them to a later pass
+        if (!page_entry.is_dirty() || page_entry.is_referenced()) continue;
+
+        if (!write_back_page(*process_space, candidate.page_number, candidate.frame)) break;
+        page_entry.set_dirty(false);
+        ++pages_precleaned;
+        ++cleaned;
+    }
+}
+
+bool Memory::handle_page_fault(ProcessMemorySpace& process_space, uint32_t page_number,
+                               std::unique_lock<std::mutex>& space_lock, bool write)
+{
     // Instead of hard limit, use a reasonable maximum (e.g., 1GB worth of pages)
     const size_t MAX_VIRTUAL_PAGES = (1024 * 1024 * 1024) / page_size; // 1GB
 
@@ -133,30 +786,58 @@ bool Memory::handle_page_fault(uint32_t pid, uint32_t page_number)
         return false; // True segmentation fault - way too high
     }
 
-    // Expand page table if needed
-    if (page_number >= process_space->page_table.entries.size()) {
-        process_space->page_table.entries.resize(page_number + 1);
-        process_space->max_pages = page_number + 1;
+    // Extend the page table if needed; only the leaf holding page_number is allocated
+    if (page_number >= process_space.page_table.size()) {
+        process_space.page_table.grow(page_number + 1);
+        process_space.max_pages = page_number + 1;
     }
 
-    auto& page_entry = process_space->page_table[page_number];
+    // A write to a shared page is a fault even when the page is resident
+    const auto& resident_entry = process_space.page_table[page_number];
+    if (resident_entry.is_present() && !(write && resident_entry.is_shared())) {
+        count_readahead_hit(process_space.page_table[page_number]);
+        return true;
+    }
 
-    if (page_entry.is_present()) {
+    // Slow path: frame_mutex must be taken before any space lock. Waiting for it is part of the fault.
+    const auto fault_start = latency_start();
+    space_lock.unlock();
+    std::lock_guard frame_lock(frame_mutex);
+    space_lock.lock();
+
+    auto& page_entry = process_space.page_table[page_number];
+
+    // Another thread of this process may have faulted the page in while the lock was dropped
+    if (page_entry.is_present() && !(write && page_entry.is_shared())) {
+        count_readahead_hit(page_entry);
         return true;
     }
 
     ++page_faults;
 
-    auto frame = allocate_frame();
+    if (page_entry.is_shared()) {
+        const bool major = !process_space.page_to_shared.at(page_number)->frame;
+        const bool mapped = write ? break_copy_on_write(process_space, page_number)
+                                  : fault_in_shared_page(process_space, page_number);
+        if (mapped) record_latency(&process_space, major ? FaultKind::eMajor : FaultKind::eMinor, fault_start);
+        return mapped;
+    }
+
+    auto frame = allocate_frame(process_space.process_id);
     if (!frame) return false;
 
-    frames[*frame].pid = pid;
-    frames[*frame].page_number = page_number;
+    assign_frame(*frame, process_space, page_number);
 
     uint32_t physical_addr = get_physical_address(*frame, 0);
 
-    if (process_space->page_to_backing_slot.find(page_number) != process_space->page_to_backing_slot.end()) {
-        backing_store->read_page(process_space->page_to_backing_slot[page_number], &memory[physical_addr]);
+    const bool major = process_space.page_to_backing_slot.contains(page_number);
+    if (major) {
+        if (!load_page(process_space.page_to_backing_slot[page_number], &memory[physical_addr])) {
+            // Mapping the frame would hand the process whatever it held before
+            unassign_frame(*frame, process_space);
+            release_frame(*frame);
+            return false;
+        }
 
         // increment page-in counter
         pages_paged_in.fetch_add(1);
@@ -169,24 +850,542 @@ bool Memory::handle_page_fault(uint32_t pid, uint32_t page_number)
     page_entry.set_valid(true);
     page_entry.set_referenced(true);
 
-    process_space->allocated_pages++;
+    process_space.allocated_pages++;
+
+    if (fault_around_pages > 0) {
+        read_ahead(process_space, page_number);
+    }
+
+    record_latency(&process_space, major ? FaultKind::eMajor : FaultKind::eMinor, fault_start);
+    return true;
+}
+
+void Memory::record_latency(ProcessMemorySpace* process_space, FaultKind kind, std::chrono::steady_clock::time_point start)
+{
+    if (start == std::chrono::steady_clock::time_point{}) return;
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    const uint64_t nanoseconds = std::max<int64_t>(elapsed.count(), 0);
+
+    fault_latency[kind].record(nanoseconds);
+    if (process_space) process_space->fault_latency[kind].record(nanoseconds);
+}
+
+void Memory::read_ahead(ProcessMemorySpace& process_space, uint32_t page_number)
+{
+    uint32_t first_page;
+    uint32_t window;
+    bool sequential = false;
+
+    // A fault just past the previous window means the process is streaming through its pages
+    const uint32_t last = process_space.last_fault_page;
+    if (last != UINT32_MAX && page_number > last && page_number <= last + process_space.readahead_window + 1) {
+        window = std::min(std::max(process_space.readahead_window * 2, fault_around_pages), readahead_max_pages);
+        first_page = page_number + 1;
+        sequential = true;
+    } else {
+        window = fault_around_pages;
+        first_page = page_number - page_number % fault_around_pages;
+    }
+
+    process_space.last_fault_page = page_number;
+    process_space.readahead_window = window;
+
+    const uint32_t end_page = static_cast<uint32_t>(
+        std::min<size_t>(static_cast<size_t>(first_page) + window, process_space.page_table.size()));
+
+    // Pages never written out are zero-filled on demand, which is cheaper than a speculative frame
+    std::vector<uint32_t> pages;
+    std::vector<uint32_t> slots;
+    for (uint32_t page = first_page; page < end_page; page++) {
+        if (page == page_number) continue;
+
+        auto slot = process_space.page_to_backing_slot.find(page);
+        if (slot == process_space.page_to_backing_slot.end() || process_space.page_table[page].is_present()) continue;
+
+        pages.push_back(page);
+        slots.push_back(slot->second);
+    }
+
+    // Plain fault-around only uses frames that are already free. A detected stream is sure enough of
+    // its next pages to evict for them, but never the page that just faulted in.
+    if (sequential) {
+        const uint32_t faulted_frame = process_space.page_table[page_number].frame_num;
+        while (free_frames.size() < pages.size()) {
+            uint32_t victim_frame = find_victim_frame(process_space.process_id);
+            if (victim_frame == faulted_frame || frames[victim_frame].is_free ||
+                !evict_frame(victim_frame, process_space.process_id)) {
+                break;
+            }
+
+            frames[victim_frame].is_free = true;
+            free_frames.push(victim_frame);
+            replacement_policy->on_free(victim_frame);
+        }
+    }
+
+    pages.resize(std::min(pages.size(), free_frames.size()));
+    slots.resize(pages.size());
+
+    std::vector<uint8_t*> destinations;
+    for (uint32_t page : pages) {
+        auto frame = allocate_frame(process_space.process_id);
+
+        assign_frame(*frame, process_space, page);
+        process_space.page_table[page].frame_num = *frame;
+
+        destinations.push_back(&memory[get_physical_address(*frame, 0)]);
+    }
+
+    if (pages.empty()) return;
+
+    // Pages still in memory are restored here; only the rest go to the file in one batch
+    size_t kept = 0;
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (load_page_from_memory(slots[i], destinations[i])) continue;
+        slots[kept] = slots[i];
+        destinations[kept] = destinations[i];
+        kept++;
+    }
+    slots.resize(kept);
+    destinations.resize(kept);
+
+    const bool read = slots.empty() || (async_io ? async_io->read_pages(slots, destinations)
+                                                 : backing_store->read_pages(slots, destinations));
+    if (!read) {
+        // Read-ahead is only a guess, so the frames are handed back and the pages left to fault
+        for (uint32_t page : pages) {
+            const uint32_t frame = process_space.page_table[page].frame_num;
+            unassign_frame(frame, process_space);
+            release_frame(frame);
+        }
+        return;
+    }
+
+    for (uint32_t page : pages) {
+        auto& page_entry = process_space.page_table[page];
+        page_entry.set_present(true);
+        page_entry.set_valid(true);
+        page_entry.set_readahead(true);
+    }
+
+    process_space.allocated_pages += pages.size();
+    pages_paged_in.fetch_add(pages.size());
+    pages_read_ahead.fetch_add(pages.size());
+}
+
+void Memory::evict_shared_frame(uint32_t victim_frame, uint32_t faulting_pid)
+{
+    SharedPage* shared = frames[victim_frame].shared;
+
+    for (const auto& [pid, page_number] : shared->mappers) {
+        ProcessMemorySpace* process_space = find_space(pid);
+        if (!process_space) continue;
+
+        std::unique_lock<std::mutex> mapper_lock;
+        if (pid != faulting_pid) {
+            mapper_lock = std::unique_lock(process_space->space_mutex);
+        }
+
+        auto& page_entry = process_space->page_table[page_number];
+        if (!page_entry.is_present() || page_entry.frame_num != victim_frame) continue;
+
+        page_entry.set_present(false);
+        page_entry.set_referenced(false);
+        page_entry.set_readahead(false);
+        shootdown(pid, page_number);
+        process_space->allocated_pages--;
+    }
+
+    // Shared content is never dirty; its backing slot already holds it
+    shared->frame.reset();
+    frames[victim_frame].shared = nullptr;
+    ++evictions;
+}
+
+bool Memory::fault_in_shared_page(ProcessMemorySpace& process_space, uint32_t page_number)
+{
+    SharedPage* shared = process_space.page_to_shared.at(page_number);
+
+    // Only the first mapper to touch a non-resident shared page pays for the page-in
+    if (!shared->frame) {
+        auto frame = allocate_frame(process_space.process_id);
+        if (!frame) return false;
+
+        if (!load_page(shared->backing_slot, &memory[get_physical_address(*frame, 0)])) {
+            release_frame(*frame);
+            return false;
+        }
+        frames[*frame].pid = NO_PID;
+        frames[*frame].shared = shared;
+        pages_paged_in.fetch_add(1);
+
+        shared->frame = *frame;
+    }
+
+    auto& page_entry = process_space.page_table[page_number];
+    page_entry.frame_num = *shared->frame;
+    page_entry.set_present(true);
+    page_entry.set_referenced(true);
+
+    process_space.allocated_pages++;
+
+    return true;
+}
+
+bool Memory::break_copy_on_write(ProcessMemorySpace& process_space, uint32_t page_number)
+{
+    SharedPage* shared = process_space.page_to_shared.at(page_number);
+
+    auto frame = allocate_frame(process_space.process_id);
+    if (!frame) return false;
+
+    // The allocation may have evicted the shared frame, so only pick the copy source now
+    uint8_t* copy = &memory[get_physical_address(*frame, 0)];
+    if (shared->frame) {
+        std::memcpy(copy, &memory[get_physical_address(*shared->frame, 0)], page_size);
+    } else {
+        if (!load_page(shared->backing_slot, copy)) {
+            release_frame(*frame);
+            return false;
+        }
+        pages_paged_in.fetch_add(1);
+    }
+
+    unmap_shared_page(process_space, page_number);
+
+    assign_frame(*frame, process_space, page_number);
+
+    // Dirty from the start: the private copy has no backing slot of its own yet
+    auto& page_entry = process_space.page_table[page_number];
+    page_entry.frame_num = *frame;
+    page_entry.set_present(true);
+    page_entry.set_referenced(true);
+    page_entry.set_dirty(true);
+
+    process_space.allocated_pages++;
+    ++cow_copies;
+
+    return true;
+}
+
+void Memory::unmap_shared_page(ProcessMemorySpace& process_space, uint32_t page_number)
+{
+    auto it = process_space.page_to_shared.find(page_number);
+    SharedPage* shared = it->second;
+    process_space.page_to_shared.erase(it);
+
+    auto& page_entry = process_space.page_table[page_number];
+    if (page_entry.is_present()) {
+        page_entry.set_present(false);
+        process_space.allocated_pages--;
+    }
+    page_entry.set_shared(false);
+    page_entry.set_referenced(false);
+    page_entry.set_readahead(false);
+    shootdown(process_space.process_id, page_number);
+
+    std::erase(shared->mappers, std::pair{process_space.process_id, page_number});
+    if (!shared->mappers.empty()) return;
+
+    if (shared->frame) {
+        frames[*shared->frame].is_free = true;
+        frames[*shared->frame].shared = nullptr;
+        free_frames.push(*shared->frame);
+        replacement_policy->on_free(*shared->frame);
+    }
+    release_slot(shared->backing_slot);
+
+    auto [first, last] = shared_pages.equal_range(shared->content_hash);
+    for (auto candidate = first; candidate != last; ++candidate) {
+        if (candidate->second.get() == shared) {
+            shared_pages.erase(candidate);
+            break;
+        }
+    }
+}
+
+SharedPage* Memory::find_shared_page(uint64_t content_hash, std::span<const uint8_t> contents)
+{
+    std::vector<uint8_t> stored;
+
+    // Equal hashes are only a hint; the bytes decide
+    auto [first, last] = shared_pages.equal_range(content_hash);
+    for (auto candidate = first; candidate != last; ++candidate) {
+        SharedPage* shared = candidate->second.get();
+
+        const uint8_t* bytes;
+        if (shared->frame) {
+            bytes = &memory[get_physical_address(*shared->frame, 0)];
+        } else {
+            // A page that cannot be read back is no candidate; comparing garbage could match
+            stored.resize(page_size);
+            if (!load_page(shared->backing_slot, stored.data())) continue;
+            bytes = stored.data();
+        }
+
+        if (std::memcmp(bytes, contents.data(), page_size) == 0) return shared;
+    }
+
+    return nullptr;
+}
+
+bool Memory::load_shared_image(uint32_t pid, uint32_t virtual_address, std::span<const uint8_t> image)
+{
+    std::shared_lock spaces_lock(spaces_mutex);
+
+    ProcessMemorySpace* process_space = find_space(pid);
+    if (!process_space || get_page_offset(virtual_address) != 0) return false;
+
+    std::lock_guard frame_lock(frame_mutex);
+    std::lock_guard space_lock(process_space->space_mutex);
+
+    const uint32_t first_page = get_page_number(virtual_address);
+    const size_t num_pages = (image.size() + page_size - 1) / page_size;
+    if (first_page + num_pages > process_space->page_table.size()) {
+        process_space->page_table.grow(first_page + num_pages);
+        process_space->max_pages = first_page + num_pages;
+    }
+
+    std::vector<uint8_t> contents(page_size);
+
+    for (size_t i = 0; i < num_pages; i++) {
+        const uint32_t page_number = first_page + static_cast<uint32_t>(i);
+        const auto chunk = image.subspan(i * page_size, std::min<size_t>(page_size, image.size() - i * page_size));
+
+        std::ranges::fill(contents, 0);
+        std::ranges::copy(chunk, contents.begin());
+
+        const uint64_t content_hash = std::hash<std::string_view>{}(
+            std::string_view(reinterpret_cast<const char*>(contents.data()), contents.size()));
+
+        SharedPage* shared = find_shared_page(content_hash, contents);
+        if (!shared) {
+            auto slot = backing_store->allocate_slot();
+            if (!slot) return false;
+            if (!store_page(*slot, contents.data())) {
+                // Never published, so no later process can dedup onto a slot without the page
+                release_slot(*slot);
+                return false;
+            }
+
+            auto page = std::make_unique<SharedPage>();
+            page->content_hash = content_hash;
+            page->backing_slot = *slot;
+            shared = page.get();
+            shared_pages.emplace(content_hash, std::move(page));
+
+            // A new page is made resident right away when that costs no eviction
+            if (!free_frames.empty()) {
+                auto frame = allocate_frame(pid);
+                frames[*frame].pid = NO_PID;
+                frames[*frame].shared = shared;
+                std::memcpy(&memory[get_physical_address(*frame, 0)], contents.data(), page_size);
+                shared->frame = *frame;
+            }
+        }
+
+        // Whatever the process had at this page is replaced by the shared mapping
+        auto& page_entry = process_space->page_table[page_number];
+        if (process_space->page_to_shared.contains(page_number)) {
+            unmap_shared_page(*process_space, page_number);
+        } else if (page_entry.is_present()) {
+            unassign_frame(page_entry.frame_num, *process_space);
+            frames[page_entry.frame_num].is_free = true;
+            free_frames.push(page_entry.frame_num);
+            replacement_policy->on_free(page_entry.frame_num);
+            process_space->allocated_pages--;
+            shootdown(pid, page_number);
+        }
+        if (auto slot = process_space->page_to_backing_slot.find(page_number);
+            slot != process_space->page_to_backing_slot.end()) {
+            release_slot(slot->second);
+            process_space->page_to_backing_slot.erase(slot);
+        }
+
+        page_entry.flags = 0;
+        page_entry.set_valid(true);
+        page_entry.set_shared(true);
+        process_space->page_to_shared[page_number] = shared;
+        shared->mappers.emplace_back(pid, page_number);
+
+        if (shared->frame) {
+            page_entry.frame_num = *shared->frame;
+            page_entry.set_present(true);
+            process_space->allocated_pages++;
+        }
+    }
 
     return true;
 }
 
+size_t Memory::get_shared_page_count() const
+{
+    std::lock_guard lock(frame_mutex);
+    return shared_pages.size();
+}
+
+FaultLatencySnapshot Memory::get_fault_latency() const
+{
+    FaultLatencySnapshot result;
+    for (size_t kind = 0; kind < NUM_FAULT_KINDS; kind++) {
+        result[kind] = fault_latency.by_kind[kind].snapshot();
+    }
+    return result;
+}
+
+std::vector<std::pair<uint32_t, FaultLatencySnapshot>> Memory::get_process_fault_latencies() const
+{
+    std::shared_lock spaces_lock(spaces_mutex);
+
+    std::vector<std::pair<uint32_t, FaultLatencySnapshot>> result;
+    result.reserve(process_spaces.size());
+    for (const auto& [pid, process_space] : process_spaces) {
+        FaultLatencySnapshot snapshot;
+        for (size_t kind = 0; kind < NUM_FAULT_KINDS; kind++) {
+            snapshot[kind] = process_space->fault_latency.by_kind[kind].snapshot();
+        }
+        result.emplace_back(pid, std::move(snapshot));
+    }
+
+    std::ranges::sort(result, {}, &std::pair<uint32_t, FaultLatencySnapshot>::first);
+    return result;
+}
+
+size_t Memory::get_shared_mapping_count() const
+{
+    std::lock_guard lock(frame_mutex);
+
+    size_t mappings = 0;
+    for (const auto& [content_hash, shared] : shared_pages) {
+        mappings += shared->mappers.size();
+    }
+    return mappings;
+}
+
+void Memory::sample_working_sets()
+{
+    const uint64_t tick = get_cpu_tick();
+    if (last_working_set_sample.exchange(tick) == tick) return;
+    const uint64_t window = working_set_window.load();
+
+    std::shared_lock spaces_lock(spaces_mutex);
+
+    size_t private_pages = 0;
+    std::unordered_set<const SharedPage*> shared_in_use;
+    for (const auto& [pid, process_space] : process_spaces) {
+        // Everything read here, page_to_shared included, only changes under space_mutex. The page
+        // table is walked instead of the owned-frame list, which would need frame_mutex on every tick.
+        std::lock_guard space_lock(process_space->space_mutex);
+
+        // Evictions sample their own pages, so the bits still set are from pages accessed since
+        process_space->page_table.for_each_allocated([&](uint32_t page_number, PageTableEntry& entry) {
+            if (entry.test_and_clear_accessed()) process_space->page_last_use[page_number] = tick;
+        });
+
+        std::erase_if(process_space->page_last_use, [&](const auto& entry) { return tick - entry.second >= window; });
+        process_space->working_set_pages = process_space->page_last_use.size();
+
+        for (const auto& [page_number, last_use] : process_space->page_last_use) {
+            auto shared_it = process_space->page_to_shared.find(page_number);
+            if (shared_it != process_space->page_to_shared.end()) {
+                shared_in_use.insert(shared_it->second);
+            } else {
+                private_pages++;
+            }
+        }
+    }
+
+    const size_t total = private_pages + shared_in_use.size();
+    total_working_set_pages.store(total);
+    if (total > frames.size()) ++thrashing_ticks;
+}
+
+size_t Memory::get_process_working_set(uint16_t pid) const
+{
+    std::shared_lock spaces_lock(spaces_mutex);
+
+    const ProcessMemorySpace* process_space = find_space(pid);
+    if (!process_space) {
+        return 0;
+    }
+
+    std::lock_guard space_lock(process_space->space_mutex);
+    return process_space->working_set_pages * page_size;
+}
+
+std::vector<std::pair<uint32_t, size_t>> Memory::get_process_working_sets() const
+{
+    std::shared_lock spaces_lock(spaces_mutex);
+
+    std::vector<std::pair<uint32_t, size_t>> result;
+    result.reserve(process_spaces.size());
+    for (const auto& [pid, process_space] : process_spaces) {
+        std::lock_guard space_lock(process_space->space_mutex);
+        result.emplace_back(pid, process_space->working_set_pages * page_size);
+    }
+
+    std::ranges::sort(result, {}, &std::pair<uint32_t, size_t>::first);
+    return result;
+}
+
+void Memory::set_fault_around(uint32_t around_pages, uint32_t max_readahead_pages)
+{
+    std::lock_guard lock(frame_mutex);
+    fault_around_pages = around_pages;
+    readahead_max_pages = std::max(around_pages, max_readahead_pages);
+}
+
+ProcessMemorySpace* Memory::translate(uint32_t pid, uint32_t page_number, std::unique_lock<std::mutex>& space_lock,
+                                      uint32_t& frame_num, bool write)
+{
+    TLB* tlb = current_tlb();
+
+    if (tlb) {
+        if (TLBEntry* entry = tlb->lookup(pid, page_number)) {
+            ProcessMemorySpace* process_space = entry->space;
+            space_lock = std::unique_lock(process_space->space_mutex);
+
+            // The entry may have been shot down between the lookup and taking the lock
+            if (entry->tag.load(std::memory_order_acquire) == TLB::make_tag(pid, page_number) &&
+                (entry->writable || !write)) {
+                tlb->record_hit();
+                frame_num = entry->frame_num;
+                return process_space;
+            }
+            space_lock.unlock();
+        }
+        tlb->record_miss();
+    }
+
+    ProcessMemorySpace* process_space = find_space(pid);
+    if (!process_space) return nullptr;
+
+    space_lock = std::unique_lock(process_space->space_mutex);
+    if (!handle_page_fault(*process_space, page_number, space_lock, write)) return nullptr;
+
+    const auto& page_entry = process_space->page_table[page_number];
+    frame_num = page_entry.frame_num;
+    if (tlb) tlb->insert(pid, page_number, frame_num, process_space, !page_entry.is_shared());
+
+    replacement_policy->on_access(frame_num, get_cpu_tick());
+
+    return process_space;
+}
+
 bool Memory::is_valid_process_access(uint32_t pid, uint32_t virtual_address) const
 {
-    std::lock_guard lock(memory_mutex);
+    std::shared_lock spaces_lock(spaces_mutex);
 
-    auto it = process_spaces.find(pid);
-    if (it == process_spaces.end()) return false;
+    const ProcessMemorySpace* process_space = find_space(pid);
+    if (!process_space) return false;
 
     uint32_t page_num = get_page_number(virtual_address);
-    auto& process_space = it->second;
 
-    if (page_num >= process_space->max_pages) return false;
+    std::lock_guard space_lock(process_space->space_mutex);
 
-    if (!process_space->page_table.entries[page_num].is_valid()) return false;
+    const PageTableEntry* page_entry = process_space->page_table.find(page_num);
+    if (!page_entry || !page_entry->is_valid()) return false;
 
     return true;
 }
@@ -194,8 +1393,6 @@ bool Memory::is_valid_process_access(uint32_t pid, uint32_t virtual_address) con
 
 bool Memory::can_allocate_process(size_t required_memory_bytes) const
 {
-    std::lock_guard lock(memory_mutex);
-
     size_t pages_needed = calculate_pages_needed(required_memory_bytes);
 
     if (backing_store) {
@@ -208,47 +1405,64 @@ bool Memory::can_allocate_process(size_t required_memory_bytes) const
 
 size_t Memory::get_available_memory() const
 {
-    std::lock_guard lock(memory_mutex);
+    std::lock_guard lock(frame_mutex);
     return free_frames.size() * page_size;
 }
 
 size_t Memory::get_total_allocated_memory() const
 {
+    std::lock_guard lock(frame_mutex);
     return (frames.size() - free_frames.size()) * page_size;
 }
 
+uint64_t Memory::get_tlb_hits() const
+{
+    uint64_t total = 0;
+    for (const auto& tlb : tlbs) total += tlb->hits.load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t Memory::get_tlb_misses() const
+{
+    uint64_t total = 0;
+    for (const auto& tlb : tlbs) total += tlb->misses.load(std::memory_order_relaxed);
+    return total;
+}
+
 size_t Memory::calculate_pages_needed(size_t memory_bytes) const
 {
     return (memory_bytes + page_size - 1) / page_size;
 }
 
 size_t Memory::get_process_memory_usage(uint16_t pid) const {
-    std::lock_guard lock(memory_mutex);
+    std::shared_lock spaces_lock(spaces_mutex);
 
-    auto it = process_spaces.find(pid);
-    if (it == process_spaces.end()) {
+    const ProcessMemorySpace* process_space = find_space(pid);
+    if (!process_space) {
         return 0;
     }
 
-    return it->second->allocated_pages * page_size;
+    std::lock_guard space_lock(process_space->space_mutex);
+    return process_space->allocated_pages * page_size;
 }
 
 size_t Memory::get_process_backing_store_usage(uint16_t pid) const
 {
-    std::lock_guard lock(memory_mutex);
+    std::shared_lock spaces_lock(spaces_mutex);
 
-    auto it = process_spaces.find(pid);
-    if (it == process_spaces.end()) {
+    const ProcessMemorySpace* process_space = find_space(pid);
+    if (!process_space) {
         return 0;
     }
 
-    return it->second->page_to_backing_slot.size() * page_size;
+    std::lock_guard space_lock(process_space->space_mutex);
+    return process_space->page_to_backing_slot.size() * page_size;
 }
 
 
 bool Memory::create_process_space(uint32_t pid, size_t memory_bytes)
 {
-    std::lock_guard lock(memory_mutex);
+    std::unique_lock spaces_lock(spaces_mutex);
 
     if (process_spaces.contains(pid)) {
         return false;
@@ -260,9 +1474,83 @@ bool Memory::create_process_space(uint32_t pid, size_t memory_bytes)
     return true;
 }
 
+size_t Memory::swap_out_process(uint32_t pid)
+{
+    std::shared_lock spaces_lock(spaces_mutex);
+
+    ProcessMemorySpace* process_space = find_space(pid);
+    if (!process_space) return 0;
+
+    std::lock_guard frame_lock(frame_mutex);
+    std::lock_guard space_lock(process_space->space_mutex);
+
+    // Gather the dirty pages first so they go out as one batch while their frames are still owned
+    std::vector<uint32_t> slots;
+    std::vector<const uint8_t*> pages;
+    std::vector<uint32_t> dirty_frames;
+    std::vector<uint32_t> to_free;
+    for (uint32_t frame = process_space->owned_frames_head; frame != Frame::NONE; frame = frames[frame].owner_next) {
+        const uint32_t page_number = frames[frame].page_number;
+        if (process_space->page_table[page_number].is_dirty()) {
+            auto slot_it = process_space->page_to_backing_slot.find(page_number);
+            if (slot_it == process_space->page_to_backing_slot.end()) {
+                // Out of swap: the page simply stays resident
+                auto slot = backing_store->allocate_slot();
+                if (!slot) continue;
+                slot_it = process_space->page_to_backing_slot.emplace(page_number, *slot).first;
+            }
+            slots.push_back(slot_it->second);
+            pages.push_back(&memory[get_physical_address(frame, 0)]);
+            dirty_frames.push_back(frame);
+        } else {
+            to_free.push_back(frame);
+        }
+    }
+
+    // The batch reports one result, so when it fails every dirty page stays resident and dirty;
+    // their slots are kept for the next attempt
+    if (store_pages(slots, pages)) {
+        to_free.insert(to_free.end(), dirty_frames.begin(), dirty_frames.end());
+        pages_paged_out.fetch_add(slots.size());
+        page_swaps += slots.size();
+    }
+
+    const uint64_t tick = get_cpu_tick();
+    for (uint32_t frame : to_free) {
+        process_space->sample_access(frames[frame].page_number, tick);
+        auto& page_entry = process_space->page_table[frames[frame].page_number];
+        page_entry.set_present(false);
+        page_entry.set_dirty(false);
+        page_entry.set_readahead(false);
+
+        unassign_frame(frame, *process_space);
+        frames[frame].is_free = true;
+        free_frames.push(frame);
+        replacement_policy->on_free(frame);
+        process_space->allocated_pages--;
+    }
+
+    for (auto& tlb : tlbs) {
+        tlb->invalidate_process(pid);
+    }
+
+    process_space->last_fault_page = UINT32_MAX;
+    process_space->readahead_window = 0;
+    pages_swapped_out += to_free.size();
+    return to_free.size();
+}
+
 void Memory::destroy_process_space(uint32_t pid)
 {
-    std::lock_guard lock(memory_mutex);
+    // Drop queued page-ins of this process and wait out one in progress, before its space goes away
+    {
+        std::unique_lock lock(io_mutex);
+        std::erase_if(io_queue, [pid](const PageInRequest& request) { return request.pid == pid; });
+        io_cv.wait(lock, [this, pid] { return io_in_flight_pid != pid; });
+    }
+
+    // Exclusive: no accessor of this process can be mid-translation while its space is torn down
+    std::unique_lock spaces_lock(spaces_mutex);
 
     auto it = process_spaces.find(pid);
     if (it == process_spaces.end())
@@ -272,28 +1560,32 @@ void Memory::destroy_process_space(uint32_t pid)
 
     size_t memory_to_free = process_space->max_pages * page_size;
 
-    std::queue<uint32_t> new_replacement_queue;
+    std::lock_guard frame_lock(frame_mutex);
 
-    for (size_t i = 0; i < frames.size(); i++) {
-        if (!frames[i].is_free && frames[i].pid == pid) {
-            frames[i].is_free = true;
-            free_frames.push(static_cast<uint32_t>(i));
-        }
+    while (!process_space->page_to_shared.empty()) {
+        unmap_shared_page(*process_space, process_space->page_to_shared.begin()->first);
     }
 
-    // Rebuild FIFO queue
-    while (!replacement_queue.empty()) {
-        uint32_t frame = replacement_queue.front();
-        replacement_queue.pop();
-        if (frames[frame].pid != pid) {
-            new_replacement_queue.push(frame);
-        }
-    }
+    // Only the frames this process owns are visited, however large physical memory is
+    for (uint32_t frame = process_space->owned_frames_head; frame != Frame::NONE;) {
+        const uint32_t next = frames[frame].owner_next;
 
-    replacement_queue = std::move(new_replacement_queue);
+        frames[frame].is_free = true;
+        frames[frame].owner_prev = Frame::NONE;
+        frames[frame].owner_next = Frame::NONE;
+        free_frames.push(frame);
+        replacement_policy->on_free(frame);
+
+        frame = next;
+    }
+    process_space->owned_frames_head = Frame::NONE;
 
     for (const auto &[page, slot]: process_space->page_to_backing_slot) {
-        backing_store->free_slot(slot);
+        release_slot(slot);
+    }
+
+    for (auto& tlb : tlbs) {
+        tlb->invalidate_process(pid);
     }
 
     process_spaces.erase(it);
@@ -310,21 +1602,20 @@ std::optional<uint8_t> Memory::read_byte(uint16_t address) const
 
 std::optional<uint8_t> Memory::read_byte(uint32_t pid, uint32_t virtual_address)
 {
-    std::lock_guard lock(memory_mutex);
-
-    const auto it = process_spaces.find(pid);
-    if (it == process_spaces.end())
-        return std::nullopt;
+    std::shared_lock spaces_lock(spaces_mutex);
 
     const uint32_t page_num = get_page_number(virtual_address);
     const uint32_t offset = get_page_offset(virtual_address);
 
-    if (!handle_page_fault(pid, page_num)) return std::nullopt;
+    std::unique_lock<std::mutex> space_lock;
+    uint32_t frame_num = 0;
+    ProcessMemorySpace* process_space = translate(pid, page_num, space_lock, frame_num, false);
+    if (!process_space)
+        return std::nullopt;
 
-    auto &page_entry = it->second->page_table[page_num];
-    page_entry.set_referenced(true);
+    process_space->page_table[page_num].set_referenced(true);
 
-    const uint32_t physical_addr = get_physical_address(page_entry.frame_num, offset);
+    const uint32_t physical_addr = get_physical_address(frame_num, offset);
     return memory[physical_addr];
 }
 
@@ -340,21 +1631,21 @@ bool Memory::write_byte(uint16_t address, uint8_t value)
 
 bool Memory::write_byte(uint32_t pid, uint32_t virtual_address, uint8_t value)
 {
-    std::lock_guard lock(memory_mutex);
-
-    const auto it = process_spaces.find(pid);
-    if (it == process_spaces.end()) return false;
+    std::shared_lock spaces_lock(spaces_mutex);
 
     uint32_t page_num = get_page_number(virtual_address);
     uint32_t offset = get_page_offset(virtual_address);
 
-    if (!handle_page_fault(pid, page_num)) return false;
+    std::unique_lock<std::mutex> space_lock;
+    uint32_t frame_num = 0;
+    ProcessMemorySpace* process_space = translate(pid, page_num, space_lock, frame_num, true);
+    if (!process_space) return false;
 
-    auto &page_entry = it->second->page_table[page_num];
+    auto &page_entry = process_space->page_table[page_num];
     page_entry.set_referenced(true);
     page_entry.set_dirty(true);
 
-    const uint32_t physical_addr = get_physical_address(page_entry.frame_num, offset);
+    const uint32_t physical_addr = get_physical_address(frame_num, offset);
     memory[physical_addr] = value;
 
     return true;
@@ -375,14 +1666,12 @@ std::optional<uint16_t> Memory::read_word(uint16_t address) const
 
 std::optional<uint16_t> Memory::read_word(uint32_t pid, uint32_t virtual_address)
 {
-    const auto low = read_byte(pid, virtual_address);
-    const auto high = read_byte(pid, virtual_address + 1);
-
-    if (low.has_value() && high.has_value()) {
-        return static_cast<uint16_t>(*low) | (static_cast<uint16_t>(*high) << 8);
+    std::array<uint8_t, 2> bytes{};
+    if (!read_bytes(pid, virtual_address, bytes)) {
+        return std::nullopt;
     }
 
-    return std::nullopt;
+    return static_cast<uint16_t>(bytes[0]) | (static_cast<uint16_t>(bytes[1]) << 8);
 }
 
 
@@ -396,10 +1685,60 @@ bool Memory::write_word(uint16_t address, uint16_t value)
 
 bool Memory::write_word(uint32_t pid, uint16_t virtual_address, uint16_t value)
 {
-    const bool low_ok = write_byte(pid, virtual_address, value & 0xff);
-    const bool high_ok = write_byte(pid, virtual_address + 1, (value >> 8) & 0xff);
+    const std::array<uint8_t, 2> bytes{static_cast<uint8_t>(value & 0xff), static_cast<uint8_t>((value >> 8) & 0xff)};
+    return write_bytes(pid, virtual_address, bytes);
+}
 
-    return low_ok && high_ok;
+bool Memory::read_bytes(uint32_t pid, uint32_t virtual_address, std::span<uint8_t> buffer)
+{
+    std::shared_lock spaces_lock(spaces_mutex);
+
+    size_t done = 0;
+    while (done < buffer.size()) {
+        const uint32_t address = virtual_address + static_cast<uint32_t>(done);
+        const uint32_t page_num = get_page_number(address);
+        const uint32_t offset = get_page_offset(address);
+        const size_t run = std::min<size_t>(page_size - offset, buffer.size() - done);
+
+        std::unique_lock<std::mutex> space_lock;
+        uint32_t frame_num = 0;
+        ProcessMemorySpace* process_space = translate(pid, page_num, space_lock, frame_num, false);
+        if (!process_space) return false;
+
+        process_space->page_table[page_num].set_referenced(true);
+        std::memcpy(buffer.data() + done, &memory[get_physical_address(frame_num, offset)], run);
+
+        done += run;
+    }
+
+    return true;
+}
+
+bool Memory::write_bytes(uint32_t pid, uint32_t virtual_address, std::span<const uint8_t> data)
+{
+    std::shared_lock spaces_lock(spaces_mutex);
+
+    size_t done = 0;
+    while (done < data.size()) {
+        const uint32_t address = virtual_address + static_cast<uint32_t>(done);
+        const uint32_t page_num = get_page_number(address);
+        const uint32_t offset = get_page_offset(address);
+        const size_t run = std::min<size_t>(page_size - offset, data.size() - done);
+
+        std::unique_lock<std::mutex> space_lock;
+        uint32_t frame_num = 0;
+        ProcessMemorySpace* process_space = translate(pid, page_num, space_lock, frame_num, true);
+        if (!process_space) return false;
+
+        auto &page_entry = process_space->page_table[page_num];
+        page_entry.set_referenced(true);
+        page_entry.set_dirty(true);
+        std::memcpy(&memory[get_physical_address(frame_num, offset)], data.data() + done, run);
+
+        done += run;
+    }
+
+    return true;
 }
 
 
@@ -408,28 +1747,41 @@ void Memory::clear()
     std::ranges::fill(memory, 0);
 }
 
-uint32_t Memory::get_var_address(uint32_t pid, std::unordered_map<std::string, size_t> &symbol_table, const std::string &var_name)
+bool Memory::set_data_segment(uint32_t pid, uint32_t base, uint32_t slot_limit)
 {
-    std::lock_guard lock(memory_mutex);
+    std::shared_lock spaces_lock(spaces_mutex);
 
-    const auto it = process_spaces.find(pid);
-    if (it == process_spaces.end()) return 0;
+    ProcessMemorySpace* process_space = find_space(pid);
+    if (!process_space) return false;
 
-    if (auto var_it = symbol_table.find(var_name); var_it != symbol_table.end()) return static_cast<uint32_t>(var_it->second);
+    std::lock_guard space_lock(process_space->space_mutex);
+    if (process_space->data_slots_used > 0) return false;
 
-    if (symbol_table.size() >= 32) {
-        return 9999999; // invalid address
-    }
-    auto& process_space = it->second;
+    process_space->data_base = base;
+    process_space->data_slot_limit = slot_limit;
+    return true;
+}
 
-    thread_local std::unordered_map<uint32_t, uint32_t> process_next_addr;
+std::optional<uint32_t> Memory::allocate_data_slot(uint32_t pid)
+{
+    std::shared_lock spaces_lock(spaces_mutex);
 
-    if (process_next_addr.find(pid) == process_next_addr.end()) process_next_addr[pid] = 0;
+    ProcessMemorySpace* process_space = find_space(pid);
+    if (!process_space) return std::nullopt;
 
-    uint32_t virtual_addr = process_next_addr[pid];
-    process_next_addr[pid] += 2;
+    std::lock_guard space_lock(process_space->space_mutex);
+    if (process_space->data_slots_used >= process_space->data_slot_limit) return std::nullopt;
 
-    symbol_table[var_name] = virtual_addr;
+    return process_space->data_slots_used++;
+}
 
-    return virtual_addr;
-}
\ No newline at end of file
+uint32_t Memory::get_data_slot_address(uint32_t pid, uint32_t slot) const
+{
+    std::shared_lock spaces_lock(spaces_mutex);
+
+    const ProcessMemorySpace* process_space = find_space(pid);
+    if (!process_space) return 0;
+
+    std::lock_guard space_lock(process_space->space_mutex);
+    return process_space->data_base + slot * ProcessMemorySpace::DATA_SLOT_SIZE;
+}
@@ -10,9 +10,26 @@
 #include <cstdint>
 #include <unordered_map>
 #include <mutex>
-#include <fstream>
+#include <shared_mutex>
 #include <queue>
 #include <optional>
+#include <atomic>
+#include <memory>
+#include <array>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <functional>
+
+#include "async_io.h"
+#include "backing_store.h"
+#include "compressed_pool.h"
+#include "latency_histogram.h"
+#include "replacement_policy.h"
 
 enum class PageFlags : uint8_t
 {
@@ -20,6 +37,9 @@ enum class PageFlags : uint8_t
     eDIRTY = 1 << 1,
     eREFERENCED = 1 << 2,
     eVALID = 1 << 3,
+    eREADAHEAD = 1 << 4, // brought in speculatively and not touched since
+    eSHARED = 1 << 5,    // maps a read-only SharedPage; the first write takes a private copy
+    eACCESSED = 1 << 6,  // set with REFERENCED, but cleared only by working-set sampling
 };
 
 struct PageTableEntry
@@ -31,6 +51,8 @@ struct PageTableEntry
     bool is_dirty() const { return flags & static_cast<uint8_t>(PageFlags::eDIRTY); }
     bool is_referenced() const { return flags & static_cast<uint8_t>(PageFlags::eREFERENCED); }
     bool is_valid() const { return flags & static_cast<uint8_t>(PageFlags::eVALID); }
+    bool is_readahead() const { return flags & static_cast<uint8_t>(PageFlags::eREADAHEAD); }
+    bool is_shared() const { return flags & static_cast<uint8_t>(PageFlags::eSHARED); }
 
     void set_present(bool value)
     {
@@ -44,84 +66,234 @@ struct PageTableEntry
         else flags &= ~static_cast<uint8_t>(PageFlags::eDIRTY);
     }
 
+    // Setting REFERENCED also sets ACCESSED, so the replacement policy clearing one leaves the other
     void set_referenced(bool value)
     {
-        if (value) flags |= static_cast<uint8_t>(PageFlags::eREFERENCED);
+        if (value) flags |= static_cast<uint8_t>(PageFlags::eREFERENCED) | static_cast<uint8_t>(PageFlags::eACCESSED);
         else flags &= ~static_cast<uint8_t>(PageFlags::eREFERENCED);
     }
 
+    bool test_and_clear_accessed()
+    {
+        const bool accessed = flags & static_cast<uint8_t>(PageFlags::eACCESSED);
+        flags &= ~static_cast<uint8_t>(PageFlags::eACCESSED);
+        return accessed;
+    }
+
     void set_valid(bool value)
     {
         if (value) flags |= static_cast<uint8_t>(PageFlags::eVALID);
         else flags &= ~static_cast<uint8_t>(PageFlags::eVALID);
     }
+
+    void set_readahead(bool value)
+    {
+        if (value) flags |= static_cast<uint8_t>(PageFlags::eREADAHEAD);
+        else flags &= ~static_cast<uint8_t>(PageFlags::eREADAHEAD);
+    }
+
+    void set_shared(bool value)
+    {
+        if (value) flags |= static_cast<uint8_t>(PageFlags::eSHARED);
+        else flags &= ~static_cast<uint8_t>(PageFlags::eSHARED);
+    }
 };
 
+// Two-level table: a directory of lazily allocated leaves of LEAF_SIZE entries, so memory grows with
+// the pages a process touches rather than with the highest address it uses.
 struct PageTable
 {
-    std::vector<PageTableEntry> entries;
+    static constexpr uint32_t LEAF_BITS = 9;
+    static constexpr uint32_t LEAF_SIZE = 1u << LEAF_BITS;
+    using Leaf = std::array<PageTableEntry, LEAF_SIZE>;
+
+    std::vector<std::unique_ptr<Leaf>> directory;
+    size_t num_pages;
+    size_t num_leaves = 0;
+
+    explicit PageTable(const size_t num_pages) : directory((num_pages + LEAF_SIZE - 1) / LEAF_SIZE), num_pages(num_pages) {}
+
+    size_t size() const { return num_pages; }
 
-    explicit PageTable(const size_t num_pages) : entries(num_pages) {}
+    void grow(const size_t new_num_pages)
+    {
+        if (new_num_pages <= num_pages) return;
+        num_pages = new_num_pages;
+        directory.resize((num_pages + LEAF_SIZE - 1) / LEAF_SIZE);
+    }
+
+    // Allocates the leaf on first use; throws for pages past size() like the flat table did
+    PageTableEntry& operator[](const uint32_t page_number)
+    {
+        auto& leaf = directory.at(page_number >> LEAF_BITS);
+        if (page_number >= num_pages) throw std::out_of_range("page number past the page table");
+        if (!leaf) {
+            leaf = std::make_unique<Leaf>();
+            num_leaves++;
+        }
+        return (*leaf)[page_number & (LEAF_SIZE - 1)];
+    }
+
+    // Calls visit(page_number, entry) for every entry of the leaves allocated so far
+    template <typename Visit>
+    void for_each_allocated(Visit&& visit)
+    {
+        for (size_t leaf = 0; leaf < directory.size(); leaf++) {
+            if (!directory[leaf]) continue;
+            for (uint32_t index = 0; index < LEAF_SIZE; index++) {
+                visit(static_cast<uint32_t>(leaf << LEAF_BITS) + index, (*directory[leaf])[index]);
+            }
+        }
+    }
+
+    // nullptr when the page is out of range or its leaf was never touched
+    const PageTableEntry* find(const uint32_t page_number) const
+    {
+        if (page_number >= num_pages) return nullptr;
+        const auto& leaf = directory[page_number >> LEAF_BITS];
+        return leaf ? &(*leaf)[page_number & (LEAF_SIZE - 1)] : nullptr;
+    }
 
-    PageTableEntry& operator[](const uint32_t page_number) {
-        return entries.at(page_number);
+    size_t memory_bytes() const
+    {
+        return directory.size() * sizeof(std::unique_ptr<Leaf>) + num_leaves * sizeof(Leaf);
     }
 };
 
+// A page whose content is identical across processes (code, string tables). Its bytes always live in
+// backing_slot; frame is set while it is resident. Guarded by Memory::frame_mutex.
+struct SharedPage
+{
+    uint64_t content_hash;
+    uint32_t backing_slot;
+    std::optional<uint32_t> frame;
+    std::vector<std::pair<uint32_t, uint32_t>> mappers; // (pid, page_number)
+};
+
+// A minor fault needs no page-in (zero-fill, mapping a resident shared page, copy-on-write from a
+// resident frame); a major fault restores the page from the compressed pool or the backing store.
+// Evictions are timed on their own, including any write-back.
+enum class FaultKind : uint8_t
+{
+    eMinor,
+    eMajor,
+    eEviction,
+};
+static constexpr size_t NUM_FAULT_KINDS = 3;
+
+struct FaultLatency
+{
+    std::array<LatencyHistogram, NUM_FAULT_KINDS> by_kind;
+
+    LatencyHistogram& operator[](FaultKind kind) { return by_kind[static_cast<size_t>(kind)]; }
+    const LatencyHistogram& operator[](FaultKind kind) const { return by_kind[static_cast<size_t>(kind)]; }
+};
+
+using FaultLatencySnapshot = std::array<LatencySnapshot, NUM_FAULT_KINDS>;
+
 struct Frame
 {
+    static constexpr uint32_t NONE = UINT32_MAX;
+
     uint32_t pid = 0;
     uint32_t page_number = 0;
     uint32_t allocation_order = 0;
     bool is_free = true;
+    SharedPage* shared = nullptr; // set instead of pid/page_number when the frame holds a SharedPage
+
+    // Links in the owning process's list of private frames
+    uint32_t owner_prev = NONE;
+    uint32_t owner_next = NONE;
 };
 
-class BackingStore
+struct ProcessMemorySpace
 {
-    uint32_t page_size;
-    std::string page_file_path;
-    std::fstream page_file;
-    std::vector<bool> allocated_slots;
-    std::mutex store_mutex;
+    uint32_t process_id;
+    PageTable page_table;
+    std::unordered_map<uint32_t, uint32_t> page_to_backing_slot;
+    std::unordered_map<uint32_t, SharedPage*> page_to_shared;
+    size_t allocated_pages = 0;
+    size_t max_pages;
 
-public:
-    explicit BackingStore(const std::string &file_path, size_t max_pages = 4294967296, uint32_t page_size = 4096) :
-        page_size(page_size), page_file_path(file_path), allocated_slots(max_pages)
-    {
-        page_file.open(page_file_path, std::ios::in | std::ios::out | std::ios::binary);
-        if (!page_file.is_open()) {
-            page_file.open(page_file_path, std::ios::out | std::ios::binary);
-            page_file.close();
-            page_file.open(page_file_path, std::ios::in | std::ios::out | std::ios::binary);
-        }
+    // Head of the private frames this process owns, linked through Frame::owner_next.
+    // Guarded by Memory::frame_mutex, not space_mutex.
+    uint32_t owned_frames_head = Frame::NONE;
 
-        page_file.seekp(max_pages * page_size - 1);
-        page_file.write("", 1);
-        page_file.flush();
-    }
+    // Data segment: variables are DATA_SLOT_SIZE-byte words handed out densely upward from data_base
+    static constexpr uint32_t DATA_SLOT_SIZE = 2;
+    uint32_t data_base = 0;
+    uint32_t data_slots_used = 0;
+    uint32_t data_slot_limit = 32;
+
+    // Sequential-fault detection for readahead
+    uint32_t last_fault_page = UINT32_MAX;
+    uint32_t readahead_window = 0;
+
+    // Faults taken by this process and evictions it had to make room with; atomics, so no lock
+    FaultLatency fault_latency;
 
-    ~BackingStore()
+    // Working set: the last tick each page was seen ACCESSED, kept after the page is evicted until it
+    // falls out of the window, and how many pages were inside the window at the last sample
+    std::unordered_map<uint32_t, uint64_t> page_last_use;
+    size_t working_set_pages = 0;
+
+    // Caller holds space_mutex
+    void sample_access(uint32_t page_number, uint64_t tick)
     {
-        if (page_file.is_open()) {
-            page_file.close();
+        if (page_table[page_number].test_and_clear_accessed()) {
+            page_last_use[page_number] = tick;
         }
     }
 
-    std::optional<uint32_t> allocate_slot();
-    void free_slot(uint32_t slot);
-    bool write_page(uint32_t slot, const uint8_t* page_data);
-    bool read_page(uint32_t slot, uint8_t* page_data);
+    // Guards page_table, page_to_backing_slot, allocated_pages, the data segment, the readahead and working-set state of this process only.
+    // page_to_shared is also only changed under Memory::frame_mutex.
+    mutable std::mutex space_mutex;
+
+    ProcessMemorySpace(const uint32_t pid, const size_t max_pages) : process_id(pid), page_table(max_pages), max_pages(max_pages) {}
 };
 
-struct ProcessMemorySpace
+struct TLBEntry
 {
-    uint32_t process_id;
-    PageTable page_table;
-    std::unordered_map<uint32_t, uint32_t> page_to_backing_slot;
-    size_t allocated_pages = 0;
-    size_t max_pages;
+    static constexpr uint64_t EMPTY = ~0ull;
 
-    ProcessMemorySpace(const uint32_t pid, const size_t max_pages) : process_id(pid), page_table(max_pages), max_pages(max_pages) {}
+    // (pid << 32) | page_number. Only the owning core fills an entry; other cores may only clear the tag.
+    std::atomic<uint64_t> tag{EMPTY};
+    uint32_t frame_num = 0;
+    ProcessMemorySpace* space = nullptr;
+    bool writable = true; // false for shared pages, so a write misses and breaks copy-on-write
+};
+
+// Small direct-mapped, pid-tagged translation cache owned by one emulated core
+class TLB
+{
+    static constexpr size_t NUM_ENTRIES = 64;
+
+    std::array<TLBEntry, NUM_ENTRIES> entries;
+
+    static size_t index(uint32_t pid, uint32_t page_number)
+    {
+        return (page_number ^ (pid * 0x9E3779B1u)) % NUM_ENTRIES;
+    }
+
+public:
+    // Written only by the owning core, so a plain load/store avoids a locked RMW per access
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+
+    void record_hit() { hits.store(hits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+    void record_miss() { misses.store(misses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+    static uint64_t make_tag(uint32_t pid, uint32_t page_number)
+    {
+        return (static_cast<uint64_t>(pid) << 32) | page_number;
+    }
+
+    TLBEntry* lookup(uint32_t pid, uint32_t page_number);
+    void insert(uint32_t pid, uint32_t page_number, uint32_t frame_num, ProcessMemorySpace* space, bool writable);
+
+    // Shootdown, called from any core while holding the target process's space lock
+    void invalidate(uint32_t pid, uint32_t page_number);
+    void invalidate_process(uint32_t pid);
 };
 
 class Memory {
@@ -135,17 +307,105 @@ class Memory {
     // Virtual memory
     uint32_t page_size;
     std::unordered_map<uint32_t, std::unique_ptr<ProcessMemorySpace>> process_spaces;
+    static constexpr size_t BACKING_STORE_SLOTS = 4096;
+    static constexpr auto BACKING_STORE_PATH = "csopesy-backing-store.txt";
     std::unique_ptr<BackingStore> backing_store;
-    std::queue<uint32_t> replacement_queue;
+    // Optional compressed tier in front of backing_store; nullptr when disabled
+    std::unique_ptr<CompressedPool> compressed_pool;
+    // Write-behind for async_io: page-outs are copied into slots_in_flight and handed to the pool
+    // WRITE_BATCH_PAGES at a time. Reads are served from the copy, a rewrite of a queued slot just
+    // replaces its copy, and anything else waits for the write, so transfers of one slot never
+    // overlap or reorder. A write that fails is queued again with its copy. inflight_mutex is a
+    // leaf lock.
+    struct InFlightWrite
+    {
+        std::unique_ptr<std::vector<uint8_t>> copy;
+        bool submitted = false;
+    };
+    static constexpr size_t WRITE_BATCH_PAGES = 16;
+    std::mutex inflight_mutex;
+    std::condition_variable inflight_cv;
+    std::unordered_map<uint32_t, InFlightWrite> slots_in_flight;
+    std::vector<uint32_t> queued_writes;
+    // Optional thread pool for backing-store I/O; nullptr keeps every transfer on the calling thread.
+    // Declared after backing_store and the in-flight set so it is torn down before them.
+    unsigned io_threads = 0;
+    std::unique_ptr<AsyncPageIO> async_io;
+    std::unique_ptr<IReplacementPolicy> replacement_policy;
+    // Content-hashed pages shared across processes; guarded by frame_mutex
+    std::unordered_multimap<uint64_t, std::unique_ptr<SharedPage>> shared_pages;
     std::atomic<uint32_t> allocation_counter{0};
 
-    mutable std::recursive_mutex memory_mutex;
+    // One TLB per emulated core, indexed by the core a CPU worker thread bound itself to
+    std::vector<std::unique_ptr<TLB>> tlbs;
+
+    // Lock order: spaces_mutex -> frame_mutex -> ProcessMemorySpace::space_mutex.
+    // A thread may hold its own space_mutex without frame_mutex only on the resident fast path,
+    // and must drop it before taking frame_mutex on a page fault.
+    mutable std::shared_mutex spaces_mutex; // guards the process_spaces map itself
+    mutable std::mutex frame_mutex;         // guards frames, free_frames and replacement state
+
+    // Background reclaim: keeps free_frames between the low and high watermarks. reclaim_mutex is a
+    // leaf lock that only guards the flags below and may be taken under frame_mutex.
+    static constexpr uint32_t NO_PID = UINT32_MAX;
+    static constexpr auto RECLAIM_PERIOD = std::chrono::milliseconds(50);
+    std::thread reclaim_thread;
+    std::mutex reclaim_mutex;
+    std::condition_variable reclaim_cv;
+    bool reclaim_running = false;
+    bool reclaim_wanted = false;
+    size_t low_watermark_frames = 0;
+    size_t high_watermark_frames = 0;
+    size_t preclean_cursor = 0;
+
+    // Asynchronous page-in: requests are served in order by io_thread, which takes the page faults on
+    // the requester's behalf. io_mutex is a leaf lock; io_in_flight_pid lets destroy_process_space
+    // wait out a request that is already running.
+    struct PageInRequest
+    {
+        uint32_t pid;
+        std::vector<uint32_t> pages;
+        std::function<void()> on_ready;
+    };
+    std::thread io_thread;
+    std::mutex io_mutex;
+    std::condition_variable io_cv;
+    std::deque<PageInRequest> io_queue;
+    std::atomic<bool> io_running{false}; // written under io_mutex, read without it by request_page_in
+    uint32_t io_in_flight_pid = NO_PID;
+
+    // Fault-around: pages mapped alongside a fault, and how far sequential readahead may grow.
+    // Both 0 means one page per fault.
+    uint32_t fault_around_pages = 0;
+    uint32_t readahead_max_pages = 0;
 
     // Stats
     std::atomic<uint64_t> page_faults{0};
     std::atomic<uint64_t> page_swaps{0};
     std::atomic<uint64_t> pages_paged_in{0};
     std::atomic<uint64_t> pages_paged_out{0};
+    std::atomic<uint64_t> evictions{0};
+    std::atomic<uint64_t> direct_reclaims{0};
+    std::atomic<uint64_t> background_reclaims{0};
+    std::atomic<uint64_t> pages_precleaned{0};
+    std::atomic<uint64_t> cow_copies{0};
+    std::atomic<uint64_t> pages_read_ahead{0};
+    std::atomic<uint64_t> readahead_hits{0};
+    std::atomic<uint64_t> async_page_ins{0};
+    std::atomic<uint64_t> async_page_writes{0};
+    std::atomic<uint64_t> inflight_write_waits{0};
+    std::atomic<uint64_t> inflight_read_hits{0};
+    std::atomic<uint64_t> coalesced_page_writes{0};
+    std::atomic<uint64_t> pages_swapped_out{0};
+    // Working-set estimate over the last working_set_window ticks, refreshed once per tick by
+    // sample_working_sets. The total counts a shared page once however many processes use it.
+    std::atomic<uint64_t> working_set_window{100};
+    std::atomic<uint64_t> last_working_set_sample{0};
+    std::atomic<size_t> total_working_set_pages{0};
+    std::atomic<uint64_t> thrashing_ticks{0};
+    // Each timed fault or eviction costs two clock reads, so the histograms can be switched off
+    std::atomic<bool> latency_tracking{true};
+    FaultLatency fault_latency;
 
     uint32_t get_page_number(uint32_t virtual_address) const
     {
@@ -162,24 +422,175 @@ class Memory {
         return frame_num * page_size + offset;
     }
 
-    uint32_t find_victim_frame();
-    std::optional<uint32_t> allocate_frame();
-    std::optional<uint32_t> evict_and_allocate();
-    bool handle_page_fault(uint32_t process_id, uint32_t page_number);
+    class FrameScan;
+
+    ProcessMemorySpace* find_space(uint32_t pid) const;
+    TLB* current_tlb() const;
+    void shootdown(uint32_t pid, uint32_t page_number);
+
+    // Caller holds spaces_mutex (shared). On success space_lock holds the owning space's lock and
+    // frame_num is the resident frame for page_number, private to the process when write is set.
+    ProcessMemorySpace* translate(uint32_t pid, uint32_t page_number, std::unique_lock<std::mutex>& space_lock,
+                                  uint32_t& frame_num, bool write);
+
+    // Callers of the following hold spaces_mutex (shared) and frame_mutex
+    uint32_t find_victim_frame(uint32_t faulting_pid);
+    std::optional<uint32_t> allocate_frame(uint32_t faulting_pid);
+    std::optional<uint32_t> evict_and_allocate(uint32_t faulting_pid);
+    // Link a private frame into, or out of, its owner's frame list
+    void assign_frame(uint32_t frame, ProcessMemorySpace& owner, uint32_t page_number);
+    void unassign_frame(uint32_t frame, ProcessMemorySpace& owner);
+
+    // Unmaps the page held in victim_frame, writing it back first if dirty. The frame is left for the
+    // caller to reuse or return to free_frames.
+    bool evict_frame(uint32_t victim_frame, uint32_t faulting_pid);
+
+    // Unmaps a resident SharedPage from every process mapping it
+    void evict_shared_frame(uint32_t victim_frame, uint32_t faulting_pid);
+
+    // Callers of the following also hold the lock of process_space
+    bool fault_in_shared_page(ProcessMemorySpace& process_space, uint32_t page_number);
+    bool break_copy_on_write(ProcessMemorySpace& process_space, uint32_t page_number);
+    // Drops one mapping and releases the page, its frame and its slot when it was the last one
+    void unmap_shared_page(ProcessMemorySpace& process_space, uint32_t page_number);
+    SharedPage* find_shared_page(uint64_t content_hash, std::span<const uint8_t> contents);
+
+    // Slot I/O through the compressed pool when there is one, falling back to backing_store. With
+    // async_io, store_page queues the file write on a copy of the page and returns without waiting.
+    // Waits, with inflight_mutex held through lock, until no write of slot is running
+    void wait_for_slot(std::unique_lock<std::mutex>& lock, uint32_t slot);
+    // Hands every queued page-out to async_io
+    void flush_page_writes();
+    bool store_page(uint32_t slot, const uint8_t* page_data);
+    // store_page for many pages; what neither the pool nor write-behind takes reaches the file in one
+    // write_pages call, in slot order
+    bool store_pages(std::span<const uint32_t> slots, std::span<const uint8_t* const> pages);
+    bool load_page(uint32_t slot, uint8_t* page_data);
+    // The part of load_page that needs no file I/O: an in-flight write's copy or the compressed pool
+    bool load_page_from_memory(uint32_t slot, uint8_t* page_data);
+    void release_slot(uint32_t slot);
+
+    // Hands back a frame from allocate_frame that a failed fault could not fill; caller holds frame_mutex
+    void release_frame(uint32_t frame);
+    // Caller holds the lock of process_space. Returns false, counting no page-out, when there is no
+    // free slot or the store fails; the page then still lives only in frame.
+    bool write_back_page(ProcessMemorySpace& process_space, uint32_t page_number, uint32_t frame);
+
+    void io_worker();
+    // Caller holds the lock of process_space. True when faulting page_number in would read the
+    // backing store, rather than zero-fill it or restore it from the compressed pool.
+    bool needs_page_in(const ProcessMemorySpace& process_space, uint32_t page_number) const;
+
+    void wake_reclaim_daemon();
+    void reclaim_worker();
+    // Caller holds spaces_mutex (shared) but not frame_mutex. Writes back up to max_pages dirty,
+    // unreferenced pages so the evictions that follow are clean.
+    void preclean_pages(size_t max_pages);
+
+    // Caller holds spaces_mutex (shared) and space_lock on process_space. The lock may be dropped and
+    // re-acquired while a frame is allocated, but is held again on return.
+    bool handle_page_fault(ProcessMemorySpace& process_space, uint32_t page_number,
+                           std::unique_lock<std::mutex>& space_lock, bool write);
+    void count_readahead_hit(PageTableEntry& page_entry)
+    {
+        if (page_entry.is_readahead()) {
+            page_entry.set_readahead(false);
+            ++readahead_hits;
+        }
+    }
+
+    // Caller holds frame_mutex and the lock of process_space. Maps neighbours of page_number that are
+    // in the backing store, using free frames only.
+    void read_ahead(ProcessMemorySpace& process_space, uint32_t page_number);
     bool is_valid_process_access(uint32_t pid, uint32_t virtual_address) const;
 
+    // latency_start returns a zero time_point while tracking is off, which record_latency then ignores.
+    // Otherwise the time since start goes into the system-wide histogram, and process_space's if given.
+    std::chrono::steady_clock::time_point latency_start() const
+    {
+        return latency_tracking.load(std::memory_order_relaxed) ? std::chrono::steady_clock::now()
+                                                                : std::chrono::steady_clock::time_point{};
+    }
+    void record_latency(ProcessMemorySpace* process_space, FaultKind kind, std::chrono::steady_clock::time_point start);
+
 public:
-    explicit Memory(const size_t total_memory = 65536, const size_t frame_size = 4096, const size_t = 256) : memory(total_memory, 0), frames(total_memory / frame_size), page_size(frame_size), max_overall_memory(total_memory), backing_store(std::make_unique<BackingStore>("csopesy-backing-store.txt", 4096, frame_size))
+    explicit Memory(const size_t total_memory = 65536, const size_t frame_size = 4096, const size_t = 256, const uint16_t num_cores = 1) : memory(total_memory, 0), frames(total_memory / frame_size), page_size(frame_size), max_overall_memory(total_memory), backing_store(std::make_unique<FileBackingStore>(BACKING_STORE_PATH, BACKING_STORE_SLOTS, frame_size))
     {
         for (size_t i = 0; i < frames.size(); i++) {
             free_frames.push(i);
             frames[i].is_free = true;
         }
+
+        replacement_policy = std::make_unique<FifoPolicy>(frames.size());
+
+        tlbs.reserve(num_cores);
+        for (uint16_t i = 0; i < num_cores; i++) {
+            tlbs.push_back(std::make_unique<TLB>());
+        }
     }
 
+    ~Memory()
+    {
+        stop_io_worker();
+        stop_reclaim_daemon();
+        if (async_io) flush_page_writes();
+        async_io.reset();
+    }
+
+    // Starts the reclaim thread; watermarks are percentages of all frames. A low watermark of 0
+    // leaves reclaim to the faulting thread, as before.
+    void start_reclaim_daemon(uint32_t low_watermark_percent, uint32_t high_watermark_percent);
+    void stop_reclaim_daemon();
+
+    // With the I/O worker running, request_page_in hands page-ins that need the backing store to it
+    // instead of letting the caller block in the fault.
+    void start_io_worker();
+    void stop_io_worker();
+
+    // Queues the pages holding virtual_addresses that need the backing store and returns true;
+    // on_ready runs on the I/O worker once they are resident, holding none of Memory's locks, and
+    // destroy_process_space waits for it to return. Returns false, without calling on_ready, when
+    // nothing needs I/O or no worker is running. Requests of a destroyed process are dropped without
+    // calling on_ready.
+    bool request_page_in(uint32_t pid, std::span<const uint32_t> virtual_addresses, std::function<void()> on_ready);
+
+    // A random fault maps the aligned block of around_pages containing it; faults that follow the
+    // previous window double it, up to max_readahead_pages. 0 turns both off.
+    void set_fault_around(uint32_t around_pages, uint32_t max_readahead_pages);
+
+    // Called once by each CPU worker so its accesses go through that core's TLB
+    static void bind_current_thread_to_core(uint16_t core_id);
+
+    // Swap the page-replacement policy by config name; returns false for an unknown name.
+    // Meant to be called before any process runs, since on_access is invoked without frame_mutex.
+    bool set_replacement_policy(std::string_view name, uint64_t working_set_window = 0);
+    std::string get_replacement_policy_name() const;
+
+    // Swap the backing-store implementation by config name ("fstream" or "mmap"). Only allowed while
+    // no process space exists, since slots are not carried over; returns false otherwise, for an
+    // unknown name, or when the page file cannot be opened (an fstream store is used then).
+    bool set_backing_store(std::string_view name, uint32_t sync_interval = 0);
+    // Installs a store the caller built, under the same rule, for stores the config cannot name
+    bool set_backing_store(std::unique_ptr<BackingStore> store);
+    std::string get_backing_store_name() const;
+
+    // Keep evicted pages compressed in up to capacity_bytes of RAM before they reach the backing
+    // store; 0 turns the pool off. Like set_backing_store, only allowed while no process space exists.
+    bool set_compressed_pool(size_t capacity_bytes);
+    std::optional<CompressedPoolStats> get_compressed_pool_stats() const;
+
+    // Run backing-store writes, and readahead batches, on a pool of threads instead of the faulting
+    // thread; 0 keeps all I/O synchronous. Only allowed while no process space exists.
+    bool set_io_threads(unsigned threads);
+
     bool create_process_space(uint32_t pid, size_t memory_bytes);
     void destroy_process_space(uint32_t pid);
 
+    // Medium-term swap-out: writes every dirty private page of pid back in one batch and frees all
+    // of its private frames. The process must not be running; its pages fault back in on demand.
+    // Dirty pages that cannot be written stay resident. Returns the number of frames freed.
+    size_t swap_out_process(uint32_t pid);
+
     bool can_allocate_process(size_t required_memory_bytes) const;
     size_t get_available_memory() const;
     size_t get_total_allocated_memory() const;
@@ -191,6 +602,45 @@ public:
 
     uint64_t get_pages_paged_in() const { return pages_paged_in.load(); }
     uint64_t get_pages_paged_out() const { return pages_paged_out.load(); }
+    uint64_t get_page_faults() const { return page_faults.load(); }
+    uint64_t get_evictions() const { return evictions.load(); }
+    uint64_t get_direct_reclaims() const { return direct_reclaims.load(); }
+    uint64_t get_background_reclaims() const { return background_reclaims.load(); }
+    uint64_t get_pages_precleaned() const { return pages_precleaned.load(); }
+    uint64_t get_pages_read_ahead() const { return pages_read_ahead.load(); }
+    uint64_t get_readahead_hits() const { return readahead_hits.load(); }
+    uint64_t get_cow_copies() const { return cow_copies.load(); }
+    uint64_t get_async_page_ins() const { return async_page_ins.load(); }
+    uint64_t get_async_page_writes() const { return async_page_writes.load(); }
+    uint64_t get_inflight_write_waits() const { return inflight_write_waits.load(); }
+    uint64_t get_inflight_read_hits() const { return inflight_read_hits.load(); }
+    uint64_t get_coalesced_page_writes() const { return coalesced_page_writes.load(); }
+    uint64_t get_pages_swapped_out() const { return pages_swapped_out.load(); }
+    size_t get_shared_page_count() const;
+    size_t get_shared_mapping_count() const;
+
+    // Working-set estimation. sample_working_sets folds every page's ACCESSED bit into its process's
+    // estimate and does nothing if it already ran this CPU tick, so it can be driven by the clock. It
+    // takes one process's space_mutex at a time and never frame_mutex.
+    void set_working_set_window(uint64_t ticks) { working_set_window.store(ticks); }
+    uint64_t get_working_set_window() const { return working_set_window.load(); }
+    void sample_working_sets();
+    size_t get_process_working_set(uint16_t pid) const;
+    // (pid, bytes) for each live process, sorted by pid
+    std::vector<std::pair<uint32_t, size_t>> get_process_working_sets() const;
+    size_t get_total_working_set() const { return total_working_set_pages.load() * page_size; }
+    // The working sets no longer fit in physical memory, so processes keep evicting each other's pages
+    bool is_thrashing() const { return total_working_set_pages.load() > frames.size(); }
+    uint64_t get_thrashing_ticks() const { return thrashing_ticks.load(); }
+
+    // Fault and eviction latency, system-wide and for each live process (sorted by pid). A process's
+    // histograms go away with its memory space; the system-wide ones keep its samples.
+    void set_latency_tracking(bool enabled) { latency_tracking.store(enabled); }
+    bool is_latency_tracking() const { return latency_tracking.load(); }
+    FaultLatencySnapshot get_fault_latency() const;
+    std::vector<std::pair<uint32_t, FaultLatencySnapshot>> get_process_fault_latencies() const;
+    uint64_t get_tlb_hits() const;
+    uint64_t get_tlb_misses() const;
 
     [[nodiscard]] std::optional<uint8_t> read_byte(uint16_t address) const;
     [[nodiscard]] std::optional<uint8_t> read_byte(uint32_t pid, uint32_t virtual_address);
@@ -204,13 +654,25 @@ public:
     bool write_word(uint16_t address, uint16_t value);
     bool write_word(uint32_t pid, uint16_t virtual_address, uint16_t value);
 
+    // Bulk access: split at page boundaries and copy each page-resident run in one memcpy
+    [[nodiscard]] bool read_bytes(uint32_t pid, uint32_t virtual_address, std::span<uint8_t> buffer);
+    bool write_bytes(uint32_t pid, uint32_t virtual_address, std::span<const uint8_t> data);
+
+    // Maps image read-only at a page-aligned address, sharing every page whose content another
+    // process already mapped this way; the first write to such a page takes a private copy.
+    // Returns false if the backing store has no room, leaving the rest of the image unmapped.
+    bool load_shared_image(uint32_t pid, uint32_t virtual_address, std::span<const uint8_t> image);
+
     void clear();
     [[nodiscard]] size_t size() const { return memory.size(); }
 
     [[nodiscard]] const uint8_t* data() const { return memory.data(); }
 
-    // Fetch variable from memory or store if it is not yet stored.
-    uint32_t get_var_address(uint32_t pid, std::unordered_map<std::string, size_t>& symbol_table, const std::string& var_name);
+    // Per-process data segment. set_data_segment places it and may only be called before the first
+    // slot is handed out; allocate_data_slot returns the next dense slot index, or nullopt when full.
+    bool set_data_segment(uint32_t pid, uint32_t base, uint32_t slot_limit);
+    std::optional<uint32_t> allocate_data_slot(uint32_t pid);
+    uint32_t get_data_slot_address(uint32_t pid, uint32_t slot) const;
 
 };
 
@@ -0,0 +1,245 @@
+#include "replacement_policy.h"
+
+void FifoPolicy::unlink(uint32_t frame)
+{
+    if (!queued[frame]) return;
+
+    if (prev[frame] != NONE) next[prev[frame]] = next[frame];
+    else head = next[frame];
+    if (next[frame] != NONE) prev[next[frame]] = prev[frame];
+    else tail = prev[frame];
+
+    prev[frame] = NONE;
+    next[frame] = NONE;
+    queued[frame] = false;
+}
+
+void FifoPolicy::on_allocate(uint32_t frame, uint64_t)
+{
+    unlink(frame);
+
+    prev[frame] = tail;
+    if (tail != NONE) next[tail] = frame;
+    else head = frame;
+    tail = frame;
+    queued[frame] = true;
+}
+
+std::optional<uint32_t> FifoPolicy::pick_victim(FrameInspector& inspector, uint64_t)
+{
+    // The victim stays queued until Memory frees it, so a search that ends without an eviction loses nothing
+    for (uint32_t frame = head; frame != NONE; frame = next[frame]) {
+        if (!inspector.is_free(frame)) {
+            return frame;
+        }
+    }
+
+    return std::nullopt;
+}
+
+void FifoPolicy::on_free(uint32_t frame)
+{
+    unlink(frame);
+}
+
+std::string FifoPolicy::get_name() const
+{
+    return "fifo";
+}
+
+std::optional<uint32_t> ClockPolicy::pick_victim(FrameInspector& inspector, uint64_t)
+{
+    const size_t num_frames = inspector.frame_count();
+
+    // Two full sweeps are enough: the first clears every REFERENCED bit it passes
+    for (size_t steps = 0; steps < 2 * num_frames; steps++) {
+        const uint32_t frame = hand;
+        hand = (hand + 1) % num_frames;
+
+        if (inspector.is_free(frame)) continue;
+
+        // Second chance: a referenced page loses its bit and survives this pass
+        if (!inspector.test_and_clear_referenced(frame)) {
+            return frame;
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::string ClockPolicy::get_name() const
+{
+    return "clock";
+}
+
+void AgingLruPolicy::age(FrameInspector& inspector, uint64_t tick)
+{
+    // One shift per tick; several evictions inside the same tick reuse the same ages
+    if (tick == last_aged_tick) return;
+    last_aged_tick = tick;
+
+    for (uint32_t frame = 0; frame < ages.size(); frame++) {
+        if (inspector.is_free(frame)) continue;
+
+        const uint8_t referenced = inspector.test_and_clear_referenced(frame) ? 0x80 : 0;
+        ages[frame].store(static_cast<uint8_t>((ages[frame].load(std::memory_order_relaxed) >> 1) | referenced),
+                          std::memory_order_relaxed);
+    }
+}
+
+void AgingLruPolicy::on_allocate(uint32_t frame, uint64_t)
+{
+    ages[frame].store(0x80, std::memory_order_relaxed);
+}
+
+void AgingLruPolicy::on_access(uint32_t frame, uint64_t)
+{
+    ages[frame].fetch_or(0x80, std::memory_order_relaxed);
+}
+
+std::optional<uint32_t> AgingLruPolicy::pick_victim(FrameInspector& inspector, uint64_t tick)
+{
+    age(inspector, tick);
+
+    std::optional<uint32_t> victim;
+    uint8_t victim_age = 0xff;
+
+    for (uint32_t frame = 0; frame < ages.size(); frame++) {
+        if (inspector.is_free(frame)) continue;
+
+        const uint8_t frame_age = ages[frame].load(std::memory_order_relaxed);
+        if (!victim || frame_age < victim_age) {
+            victim = frame;
+            victim_age = frame_age;
+        }
+    }
+
+    return victim;
+}
+
+void AgingLruPolicy::on_free(uint32_t frame)
+{
+    ages[frame].store(0, std::memory_order_relaxed);
+}
+
+std::string AgingLruPolicy::get_name() const
+{
+    return "lru";
+}
+
+void LfuPolicy::on_allocate(uint32_t frame, uint64_t)
+{
+    counts[frame].store(1, std::memory_order_relaxed);
+}
+
+void LfuPolicy::on_access(uint32_t frame, uint64_t)
+{
+    if (counts[frame].load(std::memory_order_relaxed) < MAX_COUNT) {
+        counts[frame].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::optional<uint32_t> LfuPolicy::pick_victim(FrameInspector& inspector, uint64_t)
+{
+    std::optional<uint32_t> victim;
+    uint32_t victim_count = 0;
+    bool saturated = false;
+
+    for (uint32_t frame = 0; frame < counts.size(); frame++) {
+        if (inspector.is_free(frame)) continue;
+
+        // Fold in references made through the TLB since the last eviction
+        uint32_t count = counts[frame].load(std::memory_order_relaxed);
+        if (inspector.test_and_clear_referenced(frame)) {
+            count++;
+            counts[frame].store(count, std::memory_order_relaxed);
+        }
+
+        saturated |= count >= MAX_COUNT;
+
+        if (!victim || count < victim_count) {
+            victim = frame;
+            victim_count = count;
+        }
+    }
+
+    if (saturated) {
+        for (auto& count : counts) {
+            count.store(count.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+        }
+    }
+
+    return victim;
+}
+
+void LfuPolicy::on_free(uint32_t frame)
+{
+    counts[frame].store(0, std::memory_order_relaxed);
+}
+
+std::string LfuPolicy::get_name() const
+{
+    return "lfu";
+}
+
+void WsClockPolicy::on_allocate(uint32_t frame, uint64_t tick)
+{
+    last_use[frame].store(tick, std::memory_order_relaxed);
+}
+
+void WsClockPolicy::on_access(uint32_t frame, uint64_t tick)
+{
+    last_use[frame].store(tick, std::memory_order_relaxed);
+}
+
+std::optional<uint32_t> WsClockPolicy::pick_victim(FrameInspector& inspector, uint64_t tick)
+{
+    const size_t num_frames = inspector.frame_count();
+    std::optional<uint32_t> old_dirty;
+    std::optional<uint32_t> oldest;
+    uint64_t oldest_use = 0;
+
+    for (size_t steps = 0; steps < 2 * num_frames; steps++) {
+        // After one full sweep, settle for a dirty page outside the window rather than keep scanning
+        if (steps == num_frames && old_dirty) break;
+
+        const uint32_t frame = hand;
+        hand = (hand + 1) % num_frames;
+
+        if (inspector.is_free(frame)) continue;
+
+        if (inspector.test_and_clear_referenced(frame)) {
+            last_use[frame].store(tick, std::memory_order_relaxed);
+            continue;
+        }
+
+        const uint64_t used = last_use[frame].load(std::memory_order_relaxed);
+        if (!oldest || used < oldest_use) {
+            oldest = frame;
+            oldest_use = used;
+        }
+
+        if (tick - used > window) {
+            if (!inspector.is_dirty(frame)) return frame;
+            if (!old_dirty) old_dirty = frame;
+        }
+    }
+
+    return old_dirty ? old_dirty : oldest;
+}
+
+std::string WsClockPolicy::get_name() const
+{
+    return "wsclock";
+}
+
+std::unique_ptr<IReplacementPolicy> create_replacement_policy(std::string_view name, size_t num_frames,
+                                                              uint64_t working_set_window)
+{
+    if (name == "fifo") return std::make_unique<FifoPolicy>(num_frames);
+    if (name == "clock") return std::make_unique<ClockPolicy>();
+    if (name == "lru") return std::make_unique<AgingLruPolicy>(num_frames);
+    if (name == "lfu") return std::make_unique<LfuPolicy>(num_frames);
+    if (name == "wsclock") return std::make_unique<WsClockPolicy>(num_frames, working_set_window);
+    return nullptr;
+}
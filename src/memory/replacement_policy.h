@@ -0,0 +1,121 @@
+#ifndef REPLACEMENT_POLICY_H
+#define REPLACEMENT_POLICY_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What a policy may ask Memory about a frame while choosing a victim. Only valid inside pick_victim.
+class FrameInspector
+{
+public:
+    virtual ~FrameInspector() = default;
+    virtual size_t frame_count() const = 0;
+    virtual bool is_free(uint32_t frame) const = 0;
+    virtual bool is_dirty(uint32_t frame) = 0;
+    // Reads and clears the REFERENCED bit of the page held in frame
+    virtual bool test_and_clear_referenced(uint32_t frame) = 0;
+};
+
+// on_allocate, pick_victim and on_free are called with Memory's frame_mutex held.
+// on_access runs on the page-table (TLB miss) path without it and must only touch atomics;
+// TLB hits are seen through the REFERENCED bit instead.
+class IReplacementPolicy
+{
+public:
+    virtual ~IReplacementPolicy() = default;
+    virtual void on_allocate(uint32_t frame, uint64_t tick) = 0;
+    virtual void on_access(uint32_t, uint64_t) {}
+    virtual std::optional<uint32_t> pick_victim(FrameInspector& inspector, uint64_t tick) = 0;
+    virtual void on_free(uint32_t frame) = 0;
+    virtual std::string get_name() const = 0;
+};
+
+// Allocation order kept as an intrusive doubly-linked list over frame numbers, so a freed frame is
+// unlinked in O(1) wherever it sits in the queue
+class FifoPolicy : public IReplacementPolicy
+{
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    std::vector<uint32_t> prev;
+    std::vector<uint32_t> next;
+    std::vector<bool> queued;
+    uint32_t head = NONE;
+    uint32_t tail = NONE;
+
+    void unlink(uint32_t frame);
+public:
+    explicit FifoPolicy(size_t num_frames) : prev(num_frames, NONE), next(num_frames, NONE), queued(num_frames) {}
+    void on_allocate(uint32_t frame, uint64_t tick) override;
+    std::optional<uint32_t> pick_victim(FrameInspector& inspector, uint64_t tick) override;
+    void on_free(uint32_t frame) override;
+    std::string get_name() const override;
+};
+
+class ClockPolicy : public IReplacementPolicy
+{
+    uint32_t hand = 0;
+public:
+    void on_allocate(uint32_t, uint64_t) override {}
+    std::optional<uint32_t> pick_victim(FrameInspector& inspector, uint64_t tick) override;
+    void on_free(uint32_t) override {}
+    std::string get_name() const override;
+};
+
+// Approximate LRU: an 8-bit age per frame, shifted right once per CPU tick with the REFERENCED bit
+// fed into the top. The lowest age is the least recently used.
+class AgingLruPolicy : public IReplacementPolicy
+{
+    std::vector<std::atomic<uint8_t>> ages;
+    uint64_t last_aged_tick = 0;
+
+    void age(FrameInspector& inspector, uint64_t tick);
+public:
+    explicit AgingLruPolicy(size_t num_frames) : ages(num_frames) {}
+    void on_allocate(uint32_t frame, uint64_t tick) override;
+    void on_access(uint32_t frame, uint64_t tick) override;
+    std::optional<uint32_t> pick_victim(FrameInspector& inspector, uint64_t tick) override;
+    void on_free(uint32_t frame) override;
+    std::string get_name() const override;
+};
+
+// LFU with decay: counts page-table accesses plus sampled REFERENCED bits, and halves every count
+// when one saturates so pages that were hot long ago eventually become evictable.
+class LfuPolicy : public IReplacementPolicy
+{
+    static constexpr uint32_t MAX_COUNT = 1u << 16;
+    std::vector<std::atomic<uint32_t>> counts;
+public:
+    explicit LfuPolicy(size_t num_frames) : counts(num_frames) {}
+    void on_allocate(uint32_t frame, uint64_t tick) override;
+    void on_access(uint32_t frame, uint64_t tick) override;
+    std::optional<uint32_t> pick_victim(FrameInspector& inspector, uint64_t tick) override;
+    void on_free(uint32_t frame) override;
+    std::string get_name() const override;
+};
+
+// WSClock: a clock sweep that only evicts pages outside the working-set window, preferring clean
+// ones. Falls back to the oldest page when everything is inside the window.
+class WsClockPolicy : public IReplacementPolicy
+{
+    std::vector<std::atomic<uint64_t>> last_use;
+    uint64_t window;
+    uint32_t hand = 0;
+public:
+    WsClockPolicy(size_t num_frames, uint64_t window) : last_use(num_frames), window(window) {}
+    void on_allocate(uint32_t frame, uint64_t tick) override;
+    void on_access(uint32_t frame, uint64_t tick) override;
+    std::optional<uint32_t> pick_victim(FrameInspector& inspector, uint64_t tick) override;
+    void on_free(uint32_t) override {}
+    std::string get_name() const override;
+};
+
+// Returns nullptr for an unknown name. Names match the page-replacement config values.
+std::unique_ptr<IReplacementPolicy> create_replacement_policy(std::string_view name, size_t num_frames,
+                                                              uint64_t working_set_window);
+
+#endif //REPLACEMENT_POLICY_H
@@ -0,0 +1,29 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstdint>
+
+// Code-segment format shared by the encoder and the bytecode engine in Process. Every instruction
+// is one EncodedInstruction; string operands are ids into the process's string table.
+enum class InstructionOpcode : uint8_t
+{
+    ePRINT = 0x01,
+    eDECLARE = 0x02,
+    eADD = 0x03,
+    eSUBTRACT = 0x04,
+    eSLEEP = 0x05,
+    eFOR = 0x06,
+    eREAD = 0x07,
+    eWRITE = 0x08,
+};
+
+struct EncodedInstruction
+{
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t operand1;
+    uint16_t operand2;
+    uint16_t operand3;
+};
+
+#endif //BYTECODE_H
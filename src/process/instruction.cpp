@@ -8,7 +8,13 @@
 #include "../cpu_tick.h"
 #include <limits>
 
-constexpr size_t INVALID_ADDRESS = 9999999999;
+constexpr size_t INVALID_ADDRESS = Process::INVALID_VAR_ADDRESS;
+
+static void add_var_address(Process &process, const std::string &var_name, std::vector<uint32_t> &addresses)
+{
+    const uint32_t address = process.get_var_address(var_name);
+    if (address != INVALID_ADDRESS) addresses.push_back(address);
+}
 
 
 void PrintInstruction::execute(Process &process)
@@ -18,21 +24,17 @@ void PrintInstruction::execute(Process &process)
     std::string final_message = message;
     if (has_variable) {
         size_t var_address = process.get_var_address(variable_name);
-        if (var_address == -1000) {
-            // Error: Could not get variable address (symbol table full)
-            std::string error_log = std::format("PRINT: Cannot access variable '{}' - symbol table full", variable_name);
-            std::lock_guard lock(process.log_mutex);
-            process.print_logs.push_back(error_log);
-            process.output_buffer.push_back("[ERROR] " + error_log);
+        if (var_address == INVALID_ADDRESS) {
+            // Error: Could not get variable address (data segment full)
+            std::string error_log = std::format("PRINT: Cannot access variable '{}' - data segment full", variable_name);
+            process.log_text(error_log, "[ERROR] " + error_log);
             return;
         }
         auto var_res = process.read_memory_word(var_address);
         if (!var_res) {
-            std::lock_guard lock(process.log_mutex);
             std::string log_entry = std::format("[ERROR] Memory access violation found in process \"{}\". Terminating process.", process.name);
             process.set_state(ProcessState::eFinished);
-            process.print_logs.push_back(log_entry);
-            process.output_buffer.push_back(log_entry);
+            process.log_text(log_entry, log_entry);
             return;
         }
 
@@ -49,10 +51,7 @@ void PrintInstruction::execute(Process &process)
         tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec,
         core_id, final_message);
 
-    std::lock_guard lock(process.log_mutex);
-
-    process.print_logs.push_back(log_entry);
-    process.output_buffer.push_back("[PRINT] " + final_message);
+    process.log_text(log_entry, "[PRINT] " + final_message);
 }
 
 std::string PrintInstruction::get_type_name() const
@@ -60,14 +59,19 @@ std::string PrintInstruction::get_type_name() const
     return "PRINT";
 }
 
+void PrintInstruction::collect_addresses(Process &process, std::vector<uint32_t> &addresses)
+{
+    if (has_variable) add_var_address(process, variable_name, addresses);
+}
+
 void DeclareInstruction::execute(Process &process)
 {
     uint16_t core_id = process.assigned_core.load();
 
     size_t address = process.get_var_address(var_name);
     if (address == INVALID_ADDRESS) {
-        // Error: Could not get variable address (symbol table full)
-        std::string error_log = std::format("DECLARE: Cannot declare variable '{}' - symbol table full (max 32 variables)", var_name);
+        // Error: Could not get variable address (data segment full)
+        std::string error_log = std::format("DECLARE: Cannot declare variable '{}' - data segment full", var_name);
 
         auto now = std::chrono::system_clock::now();
         auto time_t = std::chrono::system_clock::to_time_t(now);
@@ -78,9 +82,7 @@ void DeclareInstruction::execute(Process &process)
             tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec,
             core_id, error_log);
 
-        std::lock_guard lock(process.log_mutex);
-        process.print_logs.push_back(log_entry);
-        process.output_buffer.push_back("[ERROR] " + error_log);
+        process.log_text(log_entry, "[ERROR] " + error_log);
         return;
     }
     bool write_res = process.write_memory_word(address, value);
@@ -103,11 +105,7 @@ void DeclareInstruction::execute(Process &process)
         process.set_state(ProcessState::eFinished);
     }
 
-    std::lock_guard lock(process.log_mutex);
-
-    // Add to print log for viewing with process-smi
-    process.print_logs.push_back(log_entry);
-    process.output_buffer.push_back(log_entry);
+    process.log_text(log_entry, log_entry);
 }
 
 std::string DeclareInstruction::get_type_name() const
@@ -115,12 +113,17 @@ std::string DeclareInstruction::get_type_name() const
     return "DECLARE";
 }
 
+void DeclareInstruction::collect_addresses(Process &process, std::vector<uint32_t> &addresses)
+{
+    add_var_address(process, var_name, addresses);
+}
+
 void AddInstruction::execute(Process &process)
 {
     uint16_t core_id = process.assigned_core.load();
     size_t var1_address = process.get_var_address(var1);
     if (var1_address == INVALID_ADDRESS) {
-        std::string error_log = std::format("ADD: Cannot access variable '{}' - symbol table full (max 32 variables)", var1);
+        std::string error_log = std::format("ADD: Cannot access variable '{}' - data segment full", var1);
 
         auto now = std::chrono::system_clock::now();
         auto time_t = std::chrono::system_clock::to_time_t(now);
@@ -131,9 +134,7 @@ void AddInstruction::execute(Process &process)
             tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec,
             core_id, error_log);
 
-        std::lock_guard lock(process.log_mutex);
-        process.print_logs.push_back(log_entry);
-        process.output_buffer.push_back("[ERROR] " + error_log);
+        process.log_text(log_entry, "[ERROR] " + error_log);
         return;
     }
 
@@ -144,7 +145,7 @@ void AddInstruction::execute(Process &process)
     } else {
         const size_t var2_address = process.get_var_address(var2);
         if (var2_address == INVALID_ADDRESS) {
-            std::string error_log = std::format("ADD: Cannot access variable '{}' - symbol table full (max 32 variables)", var2);
+            std::string error_log = std::format("ADD: Cannot access variable '{}' - data segment full", var2);
 
             auto now = std::chrono::system_clock::now();
             auto time_t = std::chrono::system_clock::to_time_t(now);
@@ -155,18 +156,14 @@ void AddInstruction::execute(Process &process)
                 tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec,
                 core_id, error_log);
 
-            std::lock_guard lock(process.log_mutex);
-            process.print_logs.push_back(log_entry);
-            process.output_buffer.push_back("[ERROR] " + error_log);
+            process.log_text(log_entry, "[ERROR] " + error_log);
             return;
         }
         auto var2_read = process.read_memory_word(var2_address);
         if (!var2_read) {
-            std::lock_guard lock(process.log_mutex);
             std::string log_entry = std::format("[ERROR] Memory access violation found in process \"{}\". Terminating process.", process.name);
             process.set_state(ProcessState::eFinished);
-            process.print_logs.push_back(log_entry);
-            process.output_buffer.push_back(log_entry);
+            process.log_text(log_entry, log_entry);
             return;
         }
         val2 = process.read_memory_word(var2_address).value();
@@ -178,7 +175,7 @@ void AddInstruction::execute(Process &process)
     } else {
         const size_t var3_address = process.get_var_address(var3);
         if (var3_address == INVALID_ADDRESS) {
-            std::string error_log = std::format("ADD: Cannot access variable '{}' - symbol table full (max 32 variables)", var3);
+            std::string error_log = std::format("ADD: Cannot access variable '{}' - data segment full", var3);
 
             auto now = std::chrono::system_clock::now();
             auto time_t = std::chrono::system_clock::to_time_t(now);
@@ -189,18 +186,14 @@ void AddInstruction::execute(Process &process)
                 tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec,
                 core_id, error_log);
 
-            std::lock_guard lock(process.log_mutex);
-            process.print_logs.push_back(log_entry);
-            process.output_buffer.push_back("[ERROR] " + error_log);
+            process.log_text(log_entry, "[ERROR] " + error_log);
             return;
         }
         auto val3_read = process.read_memory_word(var3_address);
         if (!val3_read) {
-            std::lock_guard lock(process.log_mutex);
             std::string log_entry = std::format("[ERROR] Memory access violation found in process \"{}\". Terminating process.", process.name);
             process.set_state(ProcessState::eFinished);
-            process.print_logs.push_back(log_entry);
-            process.output_buffer.push_back(log_entry);
+            process.log_text(log_entry, log_entry);
             return;
         }
         val3 = process.read_memory_word(var3_address).value();
@@ -230,11 +223,7 @@ void AddInstruction::execute(Process &process)
         process.set_state(ProcessState::eFinished);
     }
 
-    std::lock_guard lock(process.log_mutex);
-
-    // Add to print_logs for viewing
-    process.print_logs.push_back(log_entry);
-    process.output_buffer.push_back(log_entry);
+    process.log_text(log_entry, log_entry);
 }
 
 std::string AddInstruction::get_type_name() const
@@ -242,12 +231,19 @@ std::string AddInstruction::get_type_name() const
     return "ADD";
 }
 
+void AddInstruction::collect_addresses(Process &process, std::vector<uint32_t> &addresses)
+{
+    add_var_address(process, var1, addresses);
+    if (!use_val2) add_var_address(process, var2, addresses);
+    if (!use_val3) add_var_address(process, var3, addresses);
+}
+
 void SubtractInstruction::execute(Process &process)
 {
     uint16_t core_id = process.assigned_core.load();
     size_t var1_address = process.get_var_address(var1);
     if (var1_address == INVALID_ADDRESS) {
-        std::string error_log = std::format("SUBTRACT: Cannot access variable '{}' - symbol table full (max 32 variables)", var1);
+        std::string error_log = std::format("SUBTRACT: Cannot access variable '{}' - data segment full", var1);
 
         auto now = std::chrono::system_clock::now();
         auto time_t = std::chrono::system_clock::to_time_t(now);
@@ -258,9 +254,7 @@ void SubtractInstruction::execute(Process &process)
             tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec,
             core_id, error_log);
 
-        std::lock_guard lock(process.log_mutex);
-        process.print_logs.push_back(log_entry);
-        process.output_buffer.push_back("[ERROR] " + error_log);
+        process.log_text(log_entry, "[ERROR] " + error_log);
         return;
     }
     std::string val2_str, val3_str;
@@ -270,7 +264,7 @@ void SubtractInstruction::execute(Process &process)
     } else {
         const size_t var2_address = process.get_var_address(var2);
         if (var2_address == INVALID_ADDRESS) {
-            std::string error_log = std::format("SUBTRACT: Cannot access variable '{}' - symbol table full (max 32 variables)", var2);
+            std::string error_log = std::format("SUBTRACT: Cannot access variable '{}' - data segment full", var2);
 
             auto now = std::chrono::system_clock::now();
             auto time_t = std::chrono::system_clock::to_time_t(now);
@@ -281,18 +275,14 @@ void SubtractInstruction::execute(Process &process)
                 tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec,
                 core_id, error_log);
 
-            std::lock_guard lock(process.log_mutex);
-            process.print_logs.push_back(log_entry);
-            process.output_buffer.push_back("[ERROR] " + error_log);
+            process.log_text(log_entry, "[ERROR] " + error_log);
             return;
         }
         auto val2_read = process.read_memory_word(var2_address);
         if (!val2_read) {
-            std::lock_guard lock(process.log_mutex);
             std::string log_entry = std::format("[ERROR] Memory access violation found in process \"{}\". Terminating process.", process.name);
             process.set_state(ProcessState::eFinished);
-            process.print_logs.push_back(log_entry);
-            process.output_buffer.push_back(log_entry);
+            process.log_text(log_entry, log_entry);
             return;
         }
         val2 = process.read_memory_word(var2_address).value();
@@ -304,7 +294,7 @@ void SubtractInstruction::execute(Process &process)
     } else {
         const size_t var3_address = process.get_var_address(var3);
         if (var3_address == INVALID_ADDRESS) {
-            std::string error_log = std::format("SUBTRACT: Cannot access variable '{}' - symbol table full (max 32 variables)", var3);
+            std::string error_log = std::format("SUBTRACT: Cannot access variable '{}' - data segment full", var3);
 
             auto now = std::chrono::system_clock::now();
             auto time_t = std::chrono::system_clock::to_time_t(now);
@@ -315,18 +305,14 @@ void SubtractInstruction::execute(Process &process)
                 tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec,
                 core_id, error_log);
 
-            std::lock_guard lock(process.log_mutex);
-            process.print_logs.push_back(log_entry);
-            process.output_buffer.push_back("[ERROR] " + error_log);
+            process.log_text(log_entry, "[ERROR] " + error_log);
             return;
         }
         auto val3_read = process.read_memory_word(var3_address);
         if (!val3_read) {
-            std::lock_guard lock(process.log_mutex);
             std::string log_entry = std::format("[ERROR] Memory access violation found in process \"{}\". Terminating process.", process.name);
             process.set_state(ProcessState::eFinished);
-            process.print_logs.push_back(log_entry);
-            process.output_buffer.push_back(log_entry);
+            process.log_text(log_entry, log_entry);
             return;
         }
         val3 = process.read_memory_word(var3_address).value();
@@ -358,11 +344,7 @@ void SubtractInstruction::execute(Process &process)
         log_entry = std::format("[ERROR] Memory access violation found in process \"{}\". Terminating process.", process.name);
     }
 
-    std::lock_guard lock(process.log_mutex);
-
-    // Add to print_logs for viewing
-    process.print_logs.push_back(log_entry);
-    process.output_buffer.push_back(log_entry);
+    process.log_text(log_entry, log_entry);
 }
 
 std::string SubtractInstruction::get_type_name() const
@@ -370,6 +352,13 @@ std::string SubtractInstruction::get_type_name() const
     return "SUBTRACT";
 }
 
+void SubtractInstruction::collect_addresses(Process &process, std::vector<uint32_t> &addresses)
+{
+    add_var_address(process, var1, addresses);
+    if (!use_val2) add_var_address(process, var2, addresses);
+    if (!use_val3) add_var_address(process, var3, addresses);
+}
+
 void SleepInstruction::execute(Process &process)
 {
     uint16_t core_id = process.assigned_core.load();
@@ -388,11 +377,7 @@ void SleepInstruction::execute(Process &process)
      tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec,
      core_id, sleep_start, sleep_until);
 
-    std::lock_guard lock(process.log_mutex);
-
-    // Add to print logs for viewing
-    process.print_logs.push_back(log_entry);
-    process.output_buffer.push_back(log_entry);
+    process.log_text(log_entry, log_entry);
 }
 
 std::string SleepInstruction::get_type_name() const
@@ -421,15 +406,28 @@ void ReadInstruction::execute(Process &process)
     uint16_t core_id = process.assigned_core.load();
     auto val_read = process.read_memory_word(address);
     if (!val_read) {
-        std::lock_guard lock(process.log_mutex);
         std::string log_entry = std::format("[ERROR] Memory access violation found in process \"{}\". Terminating process.", process.name);
         process.set_state(ProcessState::eFinished);
-        process.print_logs.push_back(log_entry);
-        process.output_buffer.push_back(log_entry);
+        process.log_text(log_entry, log_entry);
         return;
     }
     uint16_t val = process.read_memory_word(address).value();
     uint32_t var_address = process.get_var_address(var);
+    if (var_address == INVALID_ADDRESS) {
+        std::string error_log = std::format("READ: Cannot access variable '{}' - data segment full", var);
+
+        auto now = std::chrono::system_clock::now();
+        auto time_t = std::chrono::system_clock::to_time_t(now);
+        std::tm tm{};
+        localtime_s(&tm, &time_t);
+
+        std::string log_entry = std::format("({:02d}/{:02d}/{:04d} {:02d}:{:02d}:{:02d}) Core: {} \"{}\"",
+            tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec,
+            core_id, error_log);
+
+        process.log_text(log_entry, "[ERROR] " + error_log);
+        return;
+    }
     bool write_res = process.write_memory_word(var_address, val);
 
     auto now = std::chrono::system_clock::now();
@@ -447,11 +445,7 @@ void ReadInstruction::execute(Process &process)
         log_entry = std::format("[ERROR] Memory access violation found in process \"{}\". Terminating process.", process.name);
     }
 
-    std::lock_guard lock(process.log_mutex);
-
-    // Add to print_logs for viewing
-    process.print_logs.push_back(log_entry);
-    process.output_buffer.push_back(log_entry);
+    process.log_text(log_entry, log_entry);
 }
 
 std::string ReadInstruction::get_type_name() const
@@ -459,19 +453,43 @@ std::string ReadInstruction::get_type_name() const
     return "READ";
 }
 
+void ReadInstruction::collect_addresses(Process &process, std::vector<uint32_t> &addresses)
+{
+    addresses.push_back(address);
+    addresses.push_back(address + 1);
+    add_var_address(process, var, addresses);
+}
+
  void WriteInstruction::execute(Process &process)
 {
     uint16_t core_id = process.assigned_core.load();
-    auto read_res = process.read_memory_word(process.get_var_address(var_name));
-    if (!read_res) {
-        std::lock_guard lock(process.log_mutex);
-        std::string log_entry = std::format("[ERROR] Memory access violation found in process \"{}\". Terminating process.", process.name);
-        process.set_state(ProcessState::eFinished);
-        process.print_logs.push_back(log_entry);
-        process.output_buffer.push_back(log_entry);
-        return;
+    uint16_t val = literal;
+    if (use_var) {
+        const size_t var_address = process.get_var_address(var_name);
+        if (var_address == INVALID_ADDRESS) {
+            std::string error_log = std::format("WRITE: Cannot access variable '{}' - data segment full", var_name);
+
+            auto now = std::chrono::system_clock::now();
+            auto time_t = std::chrono::system_clock::to_time_t(now);
+            std::tm tm{};
+            localtime_s(&tm, &time_t);
+
+            std::string log_entry = std::format("({:02d}/{:02d}/{:04d} {:02d}:{:02d}:{:02d}) Core: {} \"{}\"",
+                tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                core_id, error_log);
+
+            process.log_text(log_entry, "[ERROR] " + error_log);
+            return;
+        }
+        auto read_res = process.read_memory_word(var_address);
+        if (!read_res) {
+            std::string log_entry = std::format("[ERROR] Memory access violation found in process \"{}\". Terminating process.", process.name);
+            process.set_state(ProcessState::eFinished);
+            process.log_text(log_entry, log_entry);
+            return;
+        }
+        val = read_res.value();
     }
-    uint16_t val = use_var ? read_res.value() : literal; //literal or variable
     bool write_res = process.write_memory_word(address, val);
 
     auto now = std::chrono::system_clock::now();
@@ -489,11 +507,7 @@ std::string ReadInstruction::get_type_name() const
         log_entry = std::format("[ERROR] Memory access violation found in process \"{}\". Terminating process.", process.name);
     }
 
-    std::lock_guard lock(process.log_mutex);
-
-    // Add to print_logs for viewing
-    process.print_logs.push_back(log_entry);
-    process.output_buffer.push_back(log_entry);
+    process.log_text(log_entry, log_entry);
 }
 
 std::string WriteInstruction::get_type_name()const
@@ -501,6 +515,13 @@ std::string WriteInstruction::get_type_name()const
     return "WRITE";
 }
 
+void WriteInstruction::collect_addresses(Process &process, std::vector<uint32_t> &addresses)
+{
+    addresses.push_back(address);
+    addresses.push_back(address + 1);
+    if (use_var) add_var_address(process, var_name, addresses);
+}
+
 uint16_t InstructionEncoder::encode_string(const std::string &str)
 {
     auto it = str_table.find(str);
@@ -524,6 +545,11 @@ std::string InstructionEncoder::decode_string(const uint16_t str_id) const
     return "<MISSING_STRING_" + std::to_string(str_id) + ">";
 }
 
+const std::string* InstructionEncoder::find_string(const uint16_t str_id) const
+{
+    return str_id < r_str_table.size() ? &r_str_table[str_id] : nullptr;
+}
+
 EncodedInstruction InstructionEncoder::encode_instruction(const std::shared_ptr<IInstruction> &instruction)
 {
     EncodedInstruction encoded = {0};
@@ -603,24 +629,30 @@ EncodedInstruction InstructionEncoder::encode_instruction(const std::shared_ptr<
     return encoded;
 }
 
-std::shared_ptr<IInstruction> InstructionEncoder::decode_instruction(const EncodedInstruction& encoded) const {
+std::shared_ptr<IInstruction> InstructionEncoder::decode_instruction(const EncodedInstruction& encoded) const
+{
+    return decode_instruction(encoded, [this](uint16_t str_id) { return decode_string(str_id); });
+}
+
+std::shared_ptr<IInstruction> InstructionEncoder::decode_instruction(const EncodedInstruction& encoded,
+    const std::function<std::string(uint16_t)>& decode_var) const {
     switch (static_cast<InstructionOpcode>(encoded.opcode)) {
         case InstructionOpcode::ePRINT: {
             std::string message = decode_string(encoded.operand1);
             if (encoded.flags & 0x01) {
-                std::string var_name = decode_string(encoded.operand2);
+                std::string var_name = decode_var(encoded.operand2);
                 return std::make_shared<PrintInstruction>(message, var_name);
             }
             return std::make_shared<PrintInstruction>(message);
         }
 
         case InstructionOpcode::eDECLARE: {
-            std::string var_name = decode_string(encoded.operand1);
+            std::string var_name = decode_var(encoded.operand1);
             return std::make_shared<DeclareInstruction>(var_name, encoded.operand2);
         }
 
         case InstructionOpcode::eADD: {
-            std::string var1 = decode_string(encoded.operand1);
+            std::string var1 = decode_var(encoded.operand1);
 
             if ((encoded.flags & 0x01) && (encoded.flags & 0x02)) {
                 // Both operands are literals
@@ -628,36 +660,36 @@ std::shared_ptr<IInstruction> InstructionEncoder::decode_instruction(const Encod
             }
             if (encoded.flags & 0x01) {
                 // Operand 2 is literal, operand 3 is variable
-                std::string var3 = decode_string(encoded.operand3);
+                std::string var3 = decode_var(encoded.operand3);
                 return std::make_shared<AddInstruction>(var1, encoded.operand2, var3);
             }
             if (encoded.flags & 0x02) {
                 // Operand 2 is variable, operand 3 is literal
-                std::string var2 = decode_string(encoded.operand2);
+                std::string var2 = decode_var(encoded.operand2);
                 return std::make_shared<AddInstruction>(var1, var2, encoded.operand3);
             }
             // Both operands are variables
-            std::string var2 = decode_string(encoded.operand2);
-            std::string var3 = decode_string(encoded.operand3);
+            std::string var2 = decode_var(encoded.operand2);
+            std::string var3 = decode_var(encoded.operand3);
             return std::make_shared<AddInstruction>(var1, var2, var3);
         }
 
         case InstructionOpcode::eSUBTRACT: {
-            std::string var1 = decode_string(encoded.operand1);
+            std::string var1 = decode_var(encoded.operand1);
 
             if ((encoded.flags & 0x01) && (encoded.flags & 0x02)) {
                 return std::make_shared<SubtractInstruction>(var1, encoded.operand2, encoded.operand3);
             }
             if (encoded.flags & 0x01) {
-                std::string var3 = decode_string(encoded.operand3);
+                std::string var3 = decode_var(encoded.operand3);
                 return std::make_shared<SubtractInstruction>(var1, encoded.operand2, var3);
             }
             if (encoded.flags & 0x02) {
-                std::string var2 = decode_string(encoded.operand2);
+                std::string var2 = decode_var(encoded.operand2);
                 return std::make_shared<SubtractInstruction>(var1, var2, encoded.operand3);
             }
-            std::string var2 = decode_string(encoded.operand2);
-            std::string var3 = decode_string(encoded.operand3);
+            std::string var2 = decode_var(encoded.operand2);
+            std::string var3 = decode_var(encoded.operand3);
             return std::make_shared<SubtractInstruction>(var1, var2, var3);
         }
 
@@ -665,7 +697,7 @@ std::shared_ptr<IInstruction> InstructionEncoder::decode_instruction(const Encod
             return std::make_shared<SleepInstruction>(static_cast<uint8_t>(encoded.operand1));
 
         case InstructionOpcode::eREAD: {
-            std::string var = decode_string(encoded.operand1);
+            std::string var = decode_var(encoded.operand1);
             uint32_t address = encoded.operand2 | (static_cast<uint32_t>(encoded.operand3) << 16);
             return std::make_shared<ReadInstruction>(var, address);
         }
@@ -673,7 +705,7 @@ std::shared_ptr<IInstruction> InstructionEncoder::decode_instruction(const Encod
         case InstructionOpcode::eWRITE: {
             uint32_t address = encoded.operand1 | (static_cast<uint32_t>(encoded.operand2) << 16);
             if (encoded.flags & 0x01) {
-                std::string var_name = decode_string(encoded.operand3);
+                std::string var_name = decode_var(encoded.operand3);
                 return std::make_shared<WriteInstruction>(address, var_name);
             }
             return std::make_shared<WriteInstruction>(address, encoded.operand3);
@@ -686,26 +718,29 @@ std::shared_ptr<IInstruction> InstructionEncoder::decode_instruction(const Encod
 
 void InstructionEncoder::store_str_table(const Process & process, const uint32_t base_address) const
 {
-    // Store number of strings first
-    const uint16_t num_strings = static_cast<uint16_t>(r_str_table.size());
-    bool write_ok = process.write_memory_word(base_address, num_strings);
+    process.write_memory_bytes(base_address, encode_str_table());
+}
 
-    uint32_t current_addr = base_address + 2;
+std::vector<uint8_t> InstructionEncoder::encode_str_table() const
+{
+    std::vector<uint8_t> table;
+
+    auto put_word = [&table](uint16_t value) {
+        table.push_back(static_cast<uint8_t>(value & 0xff));
+        table.push_back(static_cast<uint8_t>((value >> 8) & 0xff));
+    };
+
+    // Store number of strings first
+    put_word(static_cast<uint16_t>(r_str_table.size()));
 
     // Store each string with its length prefix
     for (size_t i = 1; i < r_str_table.size(); ++i) {
         const std::string &str = r_str_table[i];
-        const uint16_t len = static_cast<uint16_t>(str.length());
-
-        // Store length
-        write_ok = process.write_memory_word(current_addr, len);
-        current_addr += 2;
-
-        // Store string data
-        for (const char c : str) {
-            process.write_memory_byte(current_addr++, static_cast<uint8_t>(c));
-        }
+        put_word(static_cast<uint16_t>(str.length()));
+        table.insert(table.end(), str.begin(), str.end());
     }
+
+    return table;
 }
 
 
@@ -721,12 +756,9 @@ void InstructionEncoder::load_str_table(const Process & process, const uint32_t
         const uint16_t len = process.read_memory_word(current_addr).value();
         current_addr += 2;
 
-        std::string str;
-        str.reserve(len);
-
-        for (uint16_t j = 0; j < len; ++j) {
-            str += static_cast<char>(process.read_memory_byte(current_addr++).value());
-        }
+        std::string str(len, '\0');
+        (void) process.read_memory_bytes(current_addr, std::span(reinterpret_cast<uint8_t *>(str.data()), len));
+        current_addr += len;
 
         r_str_table[i] = str;
         str_table[str] = i;
@@ -5,36 +5,18 @@
 #ifndef INSTRUCTION_H
 #define INSTRUCTION_H
 
+#include "bytecode.h"
 #include "process.h"
 
 class Process;
 
-enum class InstructionOpcode : uint8_t
-{
-    ePRINT = 0x01,
-    eDECLARE = 0x02,
-    eADD = 0x03,
-    eSUBTRACT = 0x04,
-    eSLEEP = 0x05,
-    eFOR = 0x06,
-    eREAD = 0x07,
-    eWRITE = 0x08,
-};
-
-struct EncodedInstruction
-{
-    uint8_t opcode;
-    uint8_t flags;
-    uint16_t operand1;
-    uint16_t operand2;
-    uint16_t operand3;
-};
-
 class IInstruction {
 public:
     virtual ~IInstruction() = default;
     virtual void execute(Process& process) = 0;
     virtual std::string get_type_name() const = 0;
+    // Virtual addresses execute() will touch, so their pages can be brought in before it runs
+    virtual void collect_addresses(Process&, std::vector<uint32_t>&) {}
 };
 
 class PrintInstruction : public IInstruction
@@ -47,6 +29,7 @@ public:
     PrintInstruction(const std::string &message, const std::string &var_name) : message(message), variable_name(var_name), has_variable(true) {}
 
     void execute(Process& process) override;
+    void collect_addresses(Process& process, std::vector<uint32_t>& addresses) override;
     std::string get_type_name() const override;
     const std::string& get_message() const { return message; }
     const std::string& get_variable_name() const { return variable_name; }
@@ -60,6 +43,7 @@ class DeclareInstruction : public IInstruction
 public:
     DeclareInstruction(const std::string& var, const uint16_t value) : var_name(var), value(value) {}
     void execute(Process& process) override;
+    void collect_addresses(Process& process, std::vector<uint32_t>& addresses) override;
     std::string get_type_name() const override;
     const std::string& get_var_name() const { return var_name; }
     uint16_t get_value() const { return value; }
@@ -82,6 +66,7 @@ public:
     AddInstruction(const std::string& var1, const uint16_t val2, const std::string& var3) : var1(var1), var3(var3), val2(val2), use_val2(true), use_val3(false) {}
     AddInstruction(const std::string& var1, const uint16_t val2, const uint16_t val3) : var1(var1), val2(val2), val3(val3), use_val2(true), use_val3(true) {}
     void execute(Process& process) override;
+    void collect_addresses(Process& process, std::vector<uint32_t>& addresses) override;
     std::string get_type_name() const override;
     const std::string& get_var1() const { return var1; }
     const std::string& get_var2() const { return var2; }
@@ -109,6 +94,7 @@ public:
     SubtractInstruction(const std::string& var1, const uint16_t val2, const std::string& var3) : var1(var1), var3(var3), val2(val2), use_val2(true), use_val3(false) {}
     SubtractInstruction(const std::string& var1, const uint16_t val2, const uint16_t val3) : var1(var1), val2(val2), val3(val3), use_val2(true), use_val3(true) {}
     void execute(Process& process) override;
+    void collect_addresses(Process& process, std::vector<uint32_t>& addresses) override;
     std::string get_type_name() const override;
     const std::string& get_var1() const { return var1; }
     const std::string& get_var2() const { return var2; }
@@ -148,6 +134,7 @@ class ReadInstruction : public IInstruction
 public:
     ReadInstruction(const std::string& var, uint32_t address) : var(var), address(address) {}
     void execute(Process &process) override;
+    void collect_addresses(Process& process, std::vector<uint32_t>& addresses) override;
     std::string get_type_name() const override;
     const std::string& get_var() const { return var; }
     uint32_t get_address() const { return address; }
@@ -168,6 +155,7 @@ public:
     WriteInstruction(uint32_t addr, const std::string &var) : address(addr), use_var(true), var_name(var) {}
 
     void execute(Process &process) override;
+    void collect_addresses(Process& process, std::vector<uint32_t>& addresses) override;
     std::string get_type_name() const override;
     uint32_t get_address() const { return address; }
     bool uses_var() const { return use_var; }
@@ -182,13 +170,22 @@ class InstructionEncoder
     uint16_t next_str_id = 1;
 
     uint16_t encode_string(const std::string &str);
-    [[nodiscard]] std::string decode_string(uint16_t str_id) const;
 
 public:
+    [[nodiscard]] std::string decode_string(uint16_t str_id) const;
     EncodedInstruction encode_instruction(const std::shared_ptr<IInstruction>& instruction);
     [[nodiscard]] std::shared_ptr<IInstruction> decode_instruction(const EncodedInstruction& encoded) const;
+    // Variable operands go through decode_var rather than the string table, for code the link pass has
+    // rewritten to addresses
+    [[nodiscard]] std::shared_ptr<IInstruction> decode_instruction(const EncodedInstruction& encoded,
+        const std::function<std::string(uint16_t)>& decode_var) const;
+    // The string decode_string would return, without copying it; nullptr when str_id is not in the table
+    [[nodiscard]] const std::string* find_string(uint16_t str_id) const;
+    [[nodiscard]] size_t string_count() const { return r_str_table.size(); }
 
     void store_str_table(const Process & process, uint32_t base_address) const;
+    // Count word, then a length word and the bytes of each string; the layout store_str_table writes
+    [[nodiscard]] std::vector<uint8_t> encode_str_table() const;
     void load_str_table(const Process & process, uint32_t base_address);
 };
 
@@ -1,12 +1,19 @@
 #include "process.h"
 #include "instruction.h"
 
+#include <algorithm>
+#include <array>
+#include <ctime>
 #include <filesystem>
+#include <iterator>
 #include <ranges>
+#include <utility>
 
 #include "../cpu_tick.h"
 
-Process::Process(const uint16_t id, const std::string &name, const std::shared_ptr<Memory> &memory) : id(id), name(name), memory(memory), encoder(std::make_unique<InstructionEncoder>())
+Process::Process(const uint16_t id, const std::string &name, const std::shared_ptr<Memory> &memory) : id(id), name(name), memory(memory), encoder(std::make_unique<InstructionEncoder>()),
+    execution_log([this](const LogRecord& record, bool output) { return format_log_record(record, output); },
+                  std::format("logs/process_log_{}_{}.bin", name, id))
  {
     creation_time = std::chrono::system_clock::now();
     std::filesystem::create_directories("logs");
@@ -79,6 +86,7 @@ std::string Process::get_status_string() const
         case ProcessState::eWaiting: state_str = "Waiting"; break;
         case ProcessState::eRunning: state_str = "Running"; break;
         case ProcessState::eFinished: state_str = "Finished"; break;
+        case ProcessState::eSwappedOut: state_str = "Swapped Out"; break;
     }
 
     auto now = std::chrono::system_clock::now();
@@ -119,8 +127,8 @@ std::string Process::get_smi_string() const
         out << "Status: Finished!\n";
 
     out << "Logs:\n";
-    for (const auto &log: print_logs)
-        out << "  " << log << "\n";
+    // Streamed, since most of a long-running process's log is in its spill file
+    read_log_lines([&out](std::string_view log) { out << "  " << log << "\n"; });
 
     uint32_t current_inst = (program_counter.load() - code_segment_base) / sizeof(EncodedInstruction);
 
@@ -130,9 +138,23 @@ std::string Process::get_smi_string() const
     return out.str();
 }
 
+uint32_t Process::get_var_slot(const std::string &var_name)
+{
+    if (auto it = symbol_table.find(var_name); it != symbol_table.end()) return it->second;
+    if (symbols_linked) return INVALID_VAR_ADDRESS;
+
+    auto slot = memory->allocate_data_slot(id);
+    if (!slot) return INVALID_VAR_ADDRESS;
+
+    slot_addresses.push_back(memory->get_data_slot_address(id, *slot));
+    symbol_table.emplace(var_name, *slot);
+    return *slot;
+}
+
 uint32_t Process::get_var_address(const std::string &var_name)
 {
-    return memory->get_var_address(id, symbol_table, var_name);
+    const uint32_t slot = get_var_slot(var_name);
+    return slot == INVALID_VAR_ADDRESS ? INVALID_VAR_ADDRESS : get_slot_address(slot);
 }
 
 std::optional<uint8_t> Process::read_memory_byte(uint32_t virtual_address) const
@@ -142,6 +164,7 @@ std::optional<uint8_t> Process::read_memory_byte(uint32_t virtual_address) const
 
 bool Process::write_memory_byte(uint32_t virtual_address, uint8_t value) const
 {
+    invalidate_decoded(virtual_address, sizeof(value));
     return memory->write_byte(id, virtual_address, value);
 }
 
@@ -152,9 +175,41 @@ std::optional<uint16_t> Process::read_memory_word(uint32_t virtual_address) cons
 
 bool Process::write_memory_word(uint32_t virtual_address, uint16_t value) const
 {
+    invalidate_decoded(virtual_address, sizeof(value));
     return memory->write_word(id, virtual_address, value);
 }
 
+bool Process::read_memory_bytes(uint32_t virtual_address, std::span<uint8_t> buffer) const
+{
+    return memory->read_bytes(id, virtual_address, buffer);
+}
+
+bool Process::write_memory_bytes(uint32_t virtual_address, std::span<const uint8_t> data) const
+{
+    invalidate_decoded(virtual_address, data.size());
+    return memory->write_bytes(id, virtual_address, data);
+}
+
+void Process::invalidate_decoded(uint32_t virtual_address, size_t length) const
+{
+    const uint64_t code_end = code_segment_base + decoded_instructions.size() * sizeof(EncodedInstruction);
+    const uint64_t write_end = static_cast<uint64_t>(virtual_address) + length;
+    if (length == 0 || virtual_address >= code_end || write_end <= code_segment_base) return;
+
+    const size_t first = (std::max(virtual_address, code_segment_base) - code_segment_base) / sizeof(EncodedInstruction);
+    const size_t last = (std::min(write_end, code_end) - 1 - code_segment_base) / sizeof(EncodedInstruction);
+    for (size_t i = first; i <= last; i++) {
+        decoded_instructions[i].valid = false;
+        decoded_instructions[i].instruction.reset();
+    }
+}
+
+bool Process::is_decoded(uint32_t pc) const
+{
+    const size_t index = (pc - code_segment_base) / sizeof(EncodedInstruction);
+    return pc >= code_segment_base && index < decoded_instructions.size() && decoded_instructions[index].valid;
+}
+
 void Process::unroll_recursive(const std::vector<std::shared_ptr<IInstruction>> &to_expand,
                                std::vector<std::shared_ptr<IInstruction>> &target_list)
 {
@@ -181,7 +236,8 @@ void Process::unroll_instructions()
     unroll_recursive(instructions, expanded_list);
 
     instructions = std::move(expanded_list);
-
+    // The string table follows the unrolled code, not the code as written
+    str_table_base = (instructions.size() * sizeof(EncodedInstruction)) + 0x100;
 }
 
 void Process::save_smi_to_file()
@@ -195,30 +251,119 @@ void Process::save_smi_to_file()
     }
 }
 
-void Process::load_instructions_to_memory()
+bool Process::load_instructions_to_memory()
 {
-    encoder->store_str_table(*this, str_table_base);
+    std::vector<EncodedInstruction> code;
+    code.reserve(instructions.size());
+    for (const auto& inst : instructions) {
+        code.push_back(encoder->encode_instruction(inst));
+    }
+    const std::vector<uint8_t> str_table = encoder->encode_str_table();
+
+    // Variables start on the page after the image, so writing one never copies a shared code page.
+    // Addresses are 16-bit, which is the only limit on how many a process may declare.
+    const uint32_t page_size = memory->get_page_size();
+    const uint32_t image_end = str_table_base + static_cast<uint32_t>(str_table.size());
+    const uint32_t data_base = (image_end + page_size - 1) / page_size * page_size;
+    const uint32_t slot_limit = data_base < 0x10000 ? (0x10000 - data_base) / ProcessMemorySpace::DATA_SLOT_SIZE : 0;
+    memory->set_data_segment(id, data_base, slot_limit);
+    data_segment_base = data_base;
+
+    // Link: slots are handed out in program order, before anything runs
+    for (auto& encoded : code) {
+        if (!link_instruction(encoded)) {
+            set_state(ProcessState::eFinished);
+            end_time = std::chrono::system_clock::now();
+            std::string log_entry = std::format("[ERROR] Process \"{}\" names more variables than its data segment holds ({} slots). Terminating process.", name, slot_limit);
+            log_text(log_entry, log_entry);
+            return false;
+        }
+    }
+    symbols_linked = true;
+
+    // Encode the code segment and string table into one image, so byte-identical programs produce
+    // identical pages that Memory can share between processes
+    std::vector<uint8_t> image;
+    image.reserve(image_end - code_segment_base);
+
+    auto put_word = [&image](uint16_t value) {
+        image.push_back(static_cast<uint8_t>(value & 0xff));
+        image.push_back(static_cast<uint8_t>((value >> 8) & 0xff));
+    };
+
+    for (const auto& encoded : code) {
+        image.push_back(encoded.opcode);
+        image.push_back(encoded.flags);
+        put_word(encoded.operand1);
+        put_word(encoded.operand2);
+        put_word(encoded.operand3);
+    }
 
-    uint32_t current_addr = code_segment_base;
+    image.resize(str_table_base - code_segment_base, 0);
+    image.insert(image.end(), str_table.begin(), str_table.end());
 
-    for (const auto& inst : instructions) {
-        EncodedInstruction encoded = encoder->encode_instruction(inst);
+    if (!memory->load_shared_image(id, code_segment_base, image)) {
+        write_memory_bytes(code_segment_base, image);
+    }
+    decoded_instructions.assign(instructions.size(), {});
 
-        bool opcode_ok = write_memory_byte(current_addr + 0, encoded.opcode);
-        bool flags_ok = write_memory_byte(current_addr + 1, encoded.flags);
-        bool op1_ok = write_memory_word(current_addr + 2, encoded.operand1);
-        bool op2_ok = write_memory_word(current_addr + 4, encoded.operand2);
-        bool op3_ok = write_memory_word(current_addr + 6, encoded.operand3);
+    program_counter.store(code_segment_base);
+    return true;
+}
 
-        current_addr += sizeof(EncodedInstruction);
+bool Process::link_instruction(EncodedInstruction& encoded)
+{
+    auto link = [this](uint16_t& operand) {
+        const std::string* var_name = encoder->find_string(operand);
+        const uint32_t slot = var_name ? get_var_slot(*var_name) : INVALID_VAR_ADDRESS;
+        if (slot == INVALID_VAR_ADDRESS) return false;
+
+        if (slot >= linked_names.size()) linked_names.resize(slot + 1);
+        linked_names[slot] = operand;
+        operand = static_cast<uint16_t>(get_slot_address(slot));
+        return true;
+    };
+
+    switch (static_cast<InstructionOpcode>(encoded.opcode)) {
+        case InstructionOpcode::ePRINT:
+            return !(encoded.flags & 0x01) || link(encoded.operand2);
+
+        case InstructionOpcode::eDECLARE:
+        case InstructionOpcode::eREAD:
+            return link(encoded.operand1);
+
+        case InstructionOpcode::eADD:
+        case InstructionOpcode::eSUBTRACT:
+            return link(encoded.operand1) &&
+                   ((encoded.flags & 0x01) || link(encoded.operand2)) &&
+                   ((encoded.flags & 0x02) || link(encoded.operand3));
+
+        case InstructionOpcode::eWRITE:
+            return !(encoded.flags & 0x01) || link(encoded.operand3);
+
+        default:
+            return true;
     }
+}
 
+bool Process::is_linked_address(uint32_t address) const
+{
+    const uint32_t offset = address - data_segment_base;
+    return address >= data_segment_base && offset % ProcessMemorySpace::DATA_SLOT_SIZE == 0 &&
+           offset / ProcessMemorySpace::DATA_SLOT_SIZE < linked_names.size();
+}
 
-    program_counter.store(code_segment_base);
+std::string_view Process::linked_var_name(uint16_t address, std::string& storage) const
+{
+    if (is_linked_address(address)) {
+        return string_operand(linked_names[(address - data_segment_base) / ProcessMemorySpace::DATA_SLOT_SIZE], storage);
+    }
+    // Not a name any program can use, so the reference path resolves it to no slot either
+    storage = std::format("<UNLINKED_0x{:04X}>", address);
+    return storage;
 }
 
-// This function may return null. Check for this in your code if you use it
-std::shared_ptr<IInstruction> Process::fetch_instruction()
+Process::DecodedInstruction* Process::fetch_decoded()
 {
     uint32_t pc = program_counter.load();
 
@@ -227,61 +372,65 @@ std::shared_ptr<IInstruction> Process::fetch_instruction()
         return nullptr;
     }
 
-    EncodedInstruction encoded{};
+    auto& decoded = decoded_instructions[(pc - code_segment_base) / sizeof(EncodedInstruction)];
+    if (decoded.valid) {
+        return &decoded;
+    }
 
-    // Check each memory read for access violations
-    auto opcode_opt = read_memory_byte(pc);
-    if (!opcode_opt) {
+    // One bulk read instead of a locked read per field
+    std::array<uint8_t, sizeof(EncodedInstruction)> bytes{};
+    if (!read_memory_bytes(pc, bytes)) {
         // Memory access violation - log error and return null
-        std::lock_guard lock(log_mutex);
-        std::string log_entry = std::format("[ERROR] Memory access violation while fetching instruction opcode at PC 0x{:04X} in process \"{}\". Terminating process.", pc, name);
-        print_logs.push_back(log_entry);
-        output_buffer.push_back(log_entry);
-        return nullptr;
-    }
-    encoded.opcode = opcode_opt.value();
-
-    auto flags_opt = read_memory_byte(pc + 1);
-    if (!flags_opt) {
-        std::lock_guard lock(log_mutex);
-        std::string log_entry = std::format("[ERROR] Memory access violation while fetching instruction flags at PC 0x{:04X} in process \"{}\". Terminating process.", pc + 1, name);
-        print_logs.push_back(log_entry);
-        output_buffer.push_back(log_entry);
+        LogRecord entry;
+        entry.time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        entry.event = LogEvent::eFetchViolation;
+        entry.address = pc;
+        log_record(std::move(entry));
         return nullptr;
     }
-    encoded.flags = flags_opt.value();
-
-    auto operand1_opt = read_memory_word(pc + 2);
-    if (!operand1_opt) {
-        std::lock_guard lock(log_mutex);
-        std::string log_entry = std::format("[ERROR] Memory access violation while fetching instruction operand1 at PC 0x{:04X} in process \"{}\". Terminating process.", pc + 2, name);
-        print_logs.push_back(log_entry);
-        output_buffer.push_back(log_entry);
+
+    auto get_word = [&bytes](size_t offset) {
+        return static_cast<uint16_t>(bytes[offset] | (bytes[offset + 1] << 8));
+    };
+
+    decoded.encoded.opcode = bytes[0];
+    decoded.encoded.flags = bytes[1];
+    decoded.encoded.operand1 = get_word(2);
+    decoded.encoded.operand2 = get_word(4);
+    decoded.encoded.operand3 = get_word(6);
+    decoded.valid = true;
+    return &decoded;
+}
+
+// This function may return null. Check for this in your code if you use it
+std::shared_ptr<IInstruction> Process::fetch_instruction()
+{
+    DecodedInstruction* decoded = fetch_decoded();
+    if (!decoded) {
         return nullptr;
     }
-    encoded.operand1 = operand1_opt.value();
-
-    auto operand2_opt = read_memory_word(pc + 4);
-    if (!operand2_opt) {
-        std::lock_guard lock(log_mutex);
-        std::string log_entry = std::format("[ERROR] Memory access violation while fetching instruction operand2 at PC 0x{:04X} in process \"{}\". Terminating process.", pc + 4, name);
-        print_logs.push_back(log_entry);
-        output_buffer.push_back(log_entry);
-        return nullptr;
+
+    if (!decoded->instruction) {
+        decoded->instruction = encoder->decode_instruction(decoded->encoded, [this](uint16_t address) {
+            std::string storage;
+            return std::string(linked_var_name(address, storage));
+        });
     }
-    encoded.operand2 = operand2_opt.value();
-
-    auto operand3_opt = read_memory_word(pc + 6);
-    if (!operand3_opt) {
-        std::lock_guard lock(log_mutex);
-        std::string log_entry = std::format("[ERROR] Memory access violation while fetching instruction operand3 at PC 0x{:04X} in process \"{}\". Terminating process.", pc + 6, name);
-        print_logs.push_back(log_entry);
-        output_buffer.push_back(log_entry);
-        return nullptr;
+    return decoded->instruction;
+}
+
+bool Process::wait_for_page_in(std::span<const uint32_t> addresses)
+{
+    // Flag first: the worker may finish before request_page_in even returns
+    page_in_pending.store(true);
+    if (!memory->request_page_in(id, addresses, [this] { page_in_pending.store(false); })) {
+        page_in_pending.store(false);
+        return false;
     }
-    encoded.operand3 = operand3_opt.value();
 
-    return encoder->decode_instruction(encoded);
+    set_state(ProcessState::eWaiting);
+    resume_after_page_in = true;
+    return true;
 }
 
 void Process::increment_program_counter() { program_counter.fetch_add(sizeof(EncodedInstruction)); }
@@ -306,10 +455,36 @@ void Process::execute_from_memory(uint16_t core_id, uint32_t quantum, uint32_t d
         ticks_executed++;
 
         if (ticks_executed % (delay + 1) == 0) {
-            auto instruction = fetch_instruction();
-            if (!instruction) break;
-            instruction->execute(*this);
+            // Neither the fetch nor the instruction runs until every page it needs is resident, so
+            // a process that blocks on swap-in simply retries this instruction when requeued
+            const bool may_wait = !std::exchange(resume_after_page_in, false);
+            const uint32_t pc = program_counter.load();
+            if (may_wait && !is_decoded(pc) &&
+                wait_for_page_in(std::array{pc, static_cast<uint32_t>(pc + sizeof(EncodedInstruction) - 1)})) break;
+
+            if (execution_mode == ExecutionMode::eReference) {
+                auto instruction = fetch_instruction();
+                if (!instruction) break;
+
+                pending_addresses.clear();
+                instruction->collect_addresses(*this, pending_addresses);
+                if (may_wait && wait_for_page_in(pending_addresses)) break;
+
+                instruction->execute(*this);
+            } else {
+                const DecodedInstruction* decoded = fetch_decoded();
+                if (!decoded) break;
+                // A copy, since a WRITE may land on its own bytes and invalidate the entry
+                const EncodedInstruction encoded = decoded->encoded;
+
+                pending_addresses.clear();
+                collect_encoded_addresses(encoded, pending_addresses);
+                if (may_wait && wait_for_page_in(pending_addresses)) break;
+
+                if (!execute_encoded(encoded)) break;
+            }
             increment_program_counter();
+            instructions_retired.store(instructions_retired.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
         }
 
         if (get_state() == ProcessState::eWaiting) break;
@@ -320,3 +495,353 @@ void Process::execute_from_memory(uint16_t core_id, uint32_t quantum, uint32_t d
         end_time = std::chrono::system_clock::now();
     }
 }
+
+// "(MM/DD/YYYY HH:MM:SS)" for time, formatted once per second on each thread that formats logs
+static const std::string& log_timestamp(std::time_t time)
+{
+    thread_local std::time_t cached_second = -1;
+    thread_local std::string cached;
+
+    if (time != cached_second) {
+        std::tm tm{};
+        localtime_s(&tm, &time);
+        cached = std::format("({:02d}/{:02d}/{:04d} {:02d}:{:02d}:{:02d})",
+            tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+        cached_second = time;
+    }
+    return cached;
+}
+
+std::string_view Process::string_operand(uint16_t str_id, std::string& storage) const
+{
+    if (const std::string* str = encoder->find_string(str_id)) return *str;
+    storage = encoder->decode_string(str_id);
+    return storage;
+}
+
+void Process::collect_encoded_addresses(const EncodedInstruction& encoded, std::vector<uint32_t>& addresses)
+{
+    auto add_var_address = [&](uint16_t address) {
+        if (is_linked_address(address)) addresses.push_back(address);
+    };
+
+    switch (static_cast<InstructionOpcode>(encoded.opcode)) {
+        case InstructionOpcode::ePRINT:
+            if (encoded.flags & 0x01) add_var_address(encoded.operand2);
+            break;
+
+        case InstructionOpcode::eDECLARE:
+            add_var_address(encoded.operand1);
+            break;
+
+        case InstructionOpcode::eADD:
+        case InstructionOpcode::eSUBTRACT:
+            add_var_address(encoded.operand1);
+            if (!(encoded.flags & 0x01)) add_var_address(encoded.operand2);
+            if (!(encoded.flags & 0x02)) add_var_address(encoded.operand3);
+            break;
+
+        case InstructionOpcode::eREAD: {
+            const uint32_t address = encoded.operand2 | (static_cast<uint32_t>(encoded.operand3) << 16);
+            addresses.push_back(address);
+            addresses.push_back(address + 1);
+            add_var_address(encoded.operand1);
+            break;
+        }
+
+        case InstructionOpcode::eWRITE: {
+            const uint32_t address = encoded.operand1 | (static_cast<uint32_t>(encoded.operand2) << 16);
+            addresses.push_back(address);
+            addresses.push_back(address + 1);
+            if (encoded.flags & 0x01) add_var_address(encoded.operand3);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+// Same effects as the IInstruction classes, which remain the reference, and records that format to
+// the same log lines. Variable operands are linked addresses.
+bool Process::execute_encoded(const EncodedInstruction& encoded)
+{
+    const uint16_t core_id = assigned_core.load();
+
+    auto var_address = [this](uint16_t operand) {
+        return is_linked_address(operand) ? uint32_t{operand} : INVALID_VAR_ADDRESS;
+    };
+    auto record = [core_id](LogEvent event) {
+        LogRecord entry;
+        entry.time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        entry.core = core_id;
+        entry.event = event;
+        return entry;
+    };
+    auto access_violation = [&](bool terminate) {
+        if (terminate) set_state(ProcessState::eFinished);
+        log_record(record(LogEvent::eAccessViolation));
+    };
+    auto variable_error = [&](uint16_t operand) {
+        LogRecord entry = record(LogEvent::eVariableError);
+        entry.flags = encoded.opcode;
+        entry.operands[0] = operand;
+        log_record(std::move(entry));
+    };
+
+    // ADD/SUBTRACT source operand; nullopt once an error has been logged
+    auto source_operand = [&](bool literal, uint16_t operand) -> std::optional<uint16_t> {
+        if (literal) return operand;
+
+        const uint32_t address = var_address(operand);
+        if (address == INVALID_VAR_ADDRESS) {
+            variable_error(operand);
+            return std::nullopt;
+        }
+
+        auto value = read_memory_word(address);
+        if (!value) {
+            access_violation(true);
+            return std::nullopt;
+        }
+        return value;
+    };
+
+    switch (static_cast<InstructionOpcode>(encoded.opcode)) {
+        case InstructionOpcode::ePRINT: {
+            LogRecord entry = record(LogEvent::ePrint);
+            entry.flags = encoded.flags & 0x01;
+            entry.operands = {encoded.operand1, encoded.operand2, 0};
+
+            if (encoded.flags & 0x01) {
+                const uint32_t address = var_address(encoded.operand2);
+                if (address == INVALID_VAR_ADDRESS) {
+                    variable_error(encoded.operand2);
+                    return true;
+                }
+
+                auto value = read_memory_word(address);
+                if (!value) {
+                    access_violation(true);
+                    return true;
+                }
+                entry.values[0] = *value;
+            }
+
+            log_record(std::move(entry));
+            return true;
+        }
+
+        case InstructionOpcode::eDECLARE: {
+            const uint32_t address = var_address(encoded.operand1);
+            if (address == INVALID_VAR_ADDRESS) {
+                variable_error(encoded.operand1);
+                return true;
+            }
+
+            if (!write_memory_word(address, encoded.operand2)) {
+                access_violation(true);
+                return true;
+            }
+            LogRecord entry = record(LogEvent::eDeclare);
+            entry.operands[0] = encoded.operand1;
+            entry.values[0] = encoded.operand2;
+            log_record(std::move(entry));
+            return true;
+        }
+
+        case InstructionOpcode::eADD:
+        case InstructionOpcode::eSUBTRACT: {
+            const bool add = static_cast<InstructionOpcode>(encoded.opcode) == InstructionOpcode::eADD;
+
+            const uint32_t address = var_address(encoded.operand1);
+            if (address == INVALID_VAR_ADDRESS) {
+                variable_error(encoded.operand1);
+                return true;
+            }
+
+            const auto value2 = source_operand(encoded.flags & 0x01, encoded.operand2);
+            if (!value2) return true;
+            const auto value3 = source_operand(encoded.flags & 0x02, encoded.operand3);
+            if (!value3) return true;
+
+            // ADD clamps at UINT16_MAX and SUBTRACT at 0
+            const uint16_t result = add ? static_cast<uint16_t>(std::min<uint32_t>(uint32_t{*value2} + *value3, UINT16_MAX))
+                                        : static_cast<uint16_t>(*value2 >= *value3 ? *value2 - *value3 : 0);
+            if (!write_memory_word(address, result)) {
+                access_violation(true);
+                return true;
+            }
+            LogRecord entry = record(add ? LogEvent::eAdd : LogEvent::eSubtract);
+            entry.flags = encoded.flags & 0x03;
+            entry.operands = {encoded.operand1, encoded.operand2, encoded.operand3};
+            entry.values = {*value2, *value3, result};
+            log_record(std::move(entry));
+            return true;
+        }
+
+        case InstructionOpcode::eSLEEP: {
+            const uint32_t sleep_start = get_cpu_tick();
+            const uint8_t sleep_ticks = static_cast<uint8_t>(encoded.operand1);
+            set_state(ProcessState::eWaiting);
+            sleep_until_tick.store(sleep_start + sleep_ticks);
+
+            LogRecord entry = record(LogEvent::eSleep);
+            entry.address = sleep_start;
+            entry.values[0] = sleep_ticks;
+            log_record(std::move(entry));
+            return true;
+        }
+
+        case InstructionOpcode::eREAD: {
+            const uint32_t address = encoded.operand2 | (static_cast<uint32_t>(encoded.operand3) << 16);
+            auto value = read_memory_word(address);
+            if (!value) {
+                access_violation(true);
+                return true;
+            }
+
+            const uint32_t var = var_address(encoded.operand1);
+            if (var == INVALID_VAR_ADDRESS) {
+                variable_error(encoded.operand1);
+                return true;
+            }
+            if (!write_memory_word(var, *value)) {
+                access_violation(false);
+                return true;
+            }
+            LogRecord entry = record(LogEvent::eRead);
+            entry.address = address;
+            entry.operands[0] = encoded.operand1;
+            entry.values[0] = *value;
+            log_record(std::move(entry));
+            return true;
+        }
+
+        case InstructionOpcode::eWRITE: {
+            const uint32_t address = encoded.operand1 | (static_cast<uint32_t>(encoded.operand2) << 16);
+            uint16_t value = encoded.operand3;
+            if (encoded.flags & 0x01) {
+                const uint32_t var = var_address(encoded.operand3);
+                if (var == INVALID_VAR_ADDRESS) {
+                    variable_error(encoded.operand3);
+                    return true;
+                }
+                auto var_value = read_memory_word(var);
+                if (!var_value) {
+                    access_violation(true);
+                    return true;
+                }
+                value = *var_value;
+            }
+
+            if (!write_memory_word(address, value)) {
+                access_violation(false);
+                return true;
+            }
+            LogRecord entry = record(LogEvent::eWrite);
+            entry.address = address;
+            entry.values[0] = value;
+            log_record(std::move(entry));
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+void Process::log_text(std::string print_entry, std::string output_entry)
+{
+    LogRecord entry;
+    entry.text = std::make_shared<const LogText>(LogText{std::move(print_entry), std::move(output_entry)});
+    log_record(std::move(entry));
+}
+
+std::string Process::format_log_record(const LogRecord& record, bool output) const
+{
+    // Most lines read the same in both views: "(timestamp) Core: N "body""
+    auto stamped = [&record](std::string_view body) {
+        return std::format("{} Core: {} \"{}\"", log_timestamp(record.time), record.core, body);
+    };
+    std::string storage;
+
+    switch (record.event) {
+        case LogEvent::eText:
+            return output ? record.text->output : record.text->print;
+
+        case LogEvent::ePrint: {
+            std::string message(string_operand(record.operands[0], storage));
+            if (record.flags & 0x01) {
+                std::format_to(std::back_inserter(message), " {} = {}", linked_var_name(record.operands[1], storage), record.values[0]);
+            }
+            return output ? "[PRINT] " + message : stamped("PRINT " + message);
+        }
+
+        case LogEvent::eDeclare:
+            return stamped(std::format("DECLARE {} = {}", linked_var_name(record.operands[0], storage), record.values[0]));
+
+        case LogEvent::eAdd:
+        case LogEvent::eSubtract: {
+            const bool add = record.event == LogEvent::eAdd;
+            // How the log shows a source operand: the literal, or name(value)
+            auto append_operand = [&](std::string& body, bool literal, uint16_t operand, uint16_t value) {
+                if (literal) {
+                    std::format_to(std::back_inserter(body), "{}", value);
+                    return;
+                }
+                std::string name_storage;
+                std::format_to(std::back_inserter(body), "{}({})", linked_var_name(operand, name_storage), value);
+            };
+
+            std::string body = std::format("{} {} = ", add ? "ADD" : "SUBTRACT", linked_var_name(record.operands[0], storage));
+            append_operand(body, record.flags & 0x01, record.operands[1], record.values[0]);
+            body += add ? " + " : " - ";
+            append_operand(body, record.flags & 0x02, record.operands[2], record.values[1]);
+            std::format_to(std::back_inserter(body), " = {}", record.values[2]);
+            return stamped(body);
+        }
+
+        case LogEvent::eSleep:
+            return stamped(std::format("SLEEP  start: {} end: {}", record.address, record.address + record.values[0]));
+
+        case LogEvent::eRead:
+            return stamped(std::format("READ {} @ 0x{:04X} -> {}", linked_var_name(record.operands[0], storage), record.address, record.values[0]));
+
+        case LogEvent::eWrite:
+            return stamped(std::format("WRITE @0x{:04X} -> {}", record.address, record.values[0]));
+
+        case LogEvent::eVariableError: {
+            const std::string_view var_name = linked_var_name(record.operands[0], storage);
+            std::string error_log;
+            switch (static_cast<InstructionOpcode>(record.flags)) {
+                case InstructionOpcode::ePRINT:
+                    // PRINT logs this one without a timestamp
+                    error_log = std::format("PRINT: Cannot access variable '{}' - data segment full", var_name);
+                    return output ? "[ERROR] " + error_log : error_log;
+                case InstructionOpcode::eDECLARE:
+                    error_log = std::format("DECLARE: Cannot declare variable '{}' - data segment full", var_name);
+                    break;
+                default: {
+                    std::string_view instruction;
+                    switch (static_cast<InstructionOpcode>(record.flags)) {
+                        case InstructionOpcode::eADD: instruction = "ADD"; break;
+                        case InstructionOpcode::eREAD: instruction = "READ"; break;
+                        case InstructionOpcode::eWRITE: instruction = "WRITE"; break;
+                        default: instruction = "SUBTRACT"; break;
+                    }
+                    error_log = std::format("{}: Cannot access variable '{}' - data segment full", instruction, var_name);
+                    break;
+                }
+            }
+            return output ? "[ERROR] " + error_log : stamped(error_log);
+        }
+
+        case LogEvent::eAccessViolation:
+            return std::format("[ERROR] Memory access violation found in process \"{}\". Terminating process.", name);
+
+        case LogEvent::eFetchViolation:
+            return std::format("[ERROR] Memory access violation while fetching instruction at PC 0x{:04X} in process \"{}\". Terminating process.", record.address, name);
+    }
+    return {};
+}
@@ -9,13 +9,17 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include "../memory/memory.h"
+#include "bytecode.h"
 #include "instruction.h"
+#include "process_log.h"
 
 class IInstruction;
 class Session;
@@ -26,7 +30,17 @@ enum class ProcessState
     eReady,
     eRunning,
     eWaiting,
-    eFinished
+    eFinished,
+    eSwappedOut // parked by the medium-term scheduler until memory frees up
+};
+
+// How a process runs its code segment. eBytecode dispatches on each EncodedInstruction's opcode;
+// eReference decodes it back into an IInstruction and calls execute, and is kept to check the
+// bytecode engine against.
+enum class ExecutionMode
+{
+    eBytecode,
+    eReference
 };
 
 class Process
@@ -35,12 +49,14 @@ public:
     uint16_t id;
     std::string name;
     std::vector<std::shared_ptr<IInstruction>> instructions;
-    std::vector<std::string> print_logs;
     std::atomic<int> current_instruction{0};
     std::atomic<ProcessState> current_state{ProcessState::eReady};
     std::atomic<uint16_t> assigned_core{9999};
-    std::deque<std::string> output_buffer;
     std::atomic<uint64_t> sleep_until_tick{0};
+    // Set while the process waits in eWaiting for Memory's I/O worker to page its operands in
+    std::atomic<bool> page_in_pending{false};
+    // Written only by the core running the process
+    std::atomic<uint64_t> instructions_retired{0};
 
     std::chrono::system_clock::time_point creation_time;
     std::chrono::system_clock::time_point start_time;
@@ -48,10 +64,13 @@ public:
 
     std::shared_ptr<Memory> memory;
     std::shared_ptr<Session> session;
-    std::unordered_map<std::string, size_t> symbol_table;
+    // Variable name -> data-segment slot, and the dense slot -> virtual address table. A name is
+    // resolved through Memory once; every later access is a local lookup. Once load_instructions_to_memory
+    // has linked the program the table is closed, and a name it does not hold gets no slot.
+    std::unordered_map<std::string, uint32_t> symbol_table;
+    std::vector<uint32_t> slot_addresses;
 
     std::ofstream log_file;
-    mutable std::mutex log_mutex;
 
     Process(const uint16_t id, const std::string &name, const std::shared_ptr<Memory> &memory);
     ~Process();
@@ -80,6 +99,25 @@ public:
 
     std::string get_smi_string() const;
 
+    // Execution log. Instructions append compact records; text is only built by the readers below.
+    void log_record(LogRecord record) { execution_log.push(std::move(record)); }
+    // For entries formatted by the caller
+    void log_text(std::string print_entry, std::string output_entry);
+    // Every entry, oldest first, as process-smi shows it
+    void read_log_lines(const std::function<void(std::string_view)>& sink) const { execution_log.read_lines(sink); }
+    // The entries screen -r has not streamed yet, as it shows them
+    std::vector<std::string> take_output_lines() { return execution_log.take_unread(); }
+    // Entries kept in memory before older ones spill to disk. Set before the process runs.
+    void set_log_capacity(size_t capacity) { execution_log.set_capacity(capacity); }
+    // Moves the whole log to disk, for a process that has finished
+    void spill_log() { execution_log.spill_all(); }
+
+    static constexpr uint32_t INVALID_VAR_ADDRESS = UINT32_MAX;
+
+    // Slot of var_name, allocating one on first use; INVALID_VAR_ADDRESS when the data segment is full
+    // or the program is linked and never names var_name
+    uint32_t get_var_slot(const std::string &var_name);
+    uint32_t get_slot_address(uint32_t slot) const { return slot_addresses[slot]; }
     uint32_t get_var_address(const std::string &var_name);
 
     std::optional<uint8_t> read_memory_byte(uint32_t virtual_address) const;
@@ -88,7 +126,12 @@ public:
     std::optional<uint16_t> read_memory_word(uint32_t virtual_address) const;
     bool write_memory_word(uint32_t virtual_address, uint16_t value) const;
 
-    void load_instructions_to_memory();
+    bool read_memory_bytes(uint32_t virtual_address, std::span<uint8_t> buffer) const;
+    bool write_memory_bytes(uint32_t virtual_address, std::span<const uint8_t> data) const;
+
+    // Encodes and links the program and loads it into memory. False when the program names more
+    // variables than its data segment holds; the error is logged and the process must not run.
+    bool load_instructions_to_memory();
 
     void execute_from_memory(uint16_t core_id, uint32_t quantum = 0, uint32_t delay = 0);
 
@@ -100,6 +143,14 @@ public:
     void set_program_counter(uint32_t pc) { program_counter.store(pc); }
     void increment_program_counter();
 
+    ExecutionMode get_execution_mode() const { return execution_mode; }
+    void set_execution_mode(ExecutionMode mode) { execution_mode = mode; }
+
+    // The bytecode engine. execute_encoded returns false for an opcode it does not know, like a
+    // fetch that decodes to nothing.
+    bool execute_encoded(const EncodedInstruction& encoded);
+    void collect_encoded_addresses(const EncodedInstruction& encoded, std::vector<uint32_t>& addresses);
+
     void free_process_memory();
 
 private:
@@ -109,6 +160,50 @@ private:
     uint32_t str_table_base = 0x100;
     std::unique_ptr<InstructionEncoder> encoder;
     std::atomic<uint32_t> program_counter{0};
+    ExecutionMode execution_mode = ExecutionMode::eBytecode;
+    ProcessLog execution_log;
+    std::string format_log_record(const LogRecord& record, bool output) const;
+
+    // Decoded-instruction cache, one entry per instruction slot of the code segment. An entry is
+    // decoded on the first fetch of its PC and dropped when a write lands on its bytes, so steady-state
+    // fetches neither read memory nor allocate. Only the core running the process touches it; mutable
+    // because the const write helpers invalidate it.
+    struct DecodedInstruction
+    {
+        EncodedInstruction encoded{};
+        bool valid = false;
+        std::shared_ptr<IInstruction> instruction; // built on first use, in reference mode only
+    };
+    mutable std::vector<DecodedInstruction> decoded_instructions;
+    void invalidate_decoded(uint32_t virtual_address, size_t length) const;
+    bool is_decoded(uint32_t pc) const;
+    // The entry for the current PC, read from memory on a miss; nullptr past the end of the code or
+    // on an access violation, which is logged
+    DecodedInstruction* fetch_decoded();
+
+    // The link pass gives every variable named by the program a slot up front and rewrites its
+    // operands from string ids to the slot's address, so execution never resolves a name.
+    // linked_names maps a slot back to the id of its name, for log lines and reference decoding.
+    bool symbols_linked = false;
+    uint32_t data_segment_base = 0;
+    std::vector<uint16_t> linked_names;
+    bool link_instruction(EncodedInstruction& encoded);
+    // True when address is the address of a linked variable. A WRITE into the code segment can leave
+    // an operand that is not.
+    bool is_linked_address(uint32_t address) const;
+    // The name a log line shows for a variable operand; storage holds it when it is made up
+    std::string_view linked_var_name(uint16_t address, std::string& storage) const;
+    // The text behind str_id; storage holds it when it is not in the string table
+    std::string_view string_operand(uint16_t str_id, std::string& storage) const;
+
+    std::vector<uint32_t> pending_addresses;
+    // The instruction after a page-in wait faults synchronously, so a page evicted again before the
+    // process is rescheduled cannot keep it waiting forever
+    bool resume_after_page_in = false;
+
+    // Hands the pages behind addresses to the I/O worker when they need the backing store, and puts
+    // the process into eWaiting until they land. Returns false when they can be accessed right away.
+    bool wait_for_page_in(std::span<const uint32_t> addresses);
 
     void unroll_recursive(const std::vector<std::shared_ptr<IInstruction>>& to_expand, std::vector<std::shared_ptr<IInstruction>>& target_list);
 };
@@ -0,0 +1,233 @@
+#include "process_log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+
+// Spill file layout, in host byte order since only the process that wrote it reads it back: the
+// fixed fields of each record, then for eText a length-prefixed print and output string.
+namespace
+{
+    constexpr size_t FIXED_RECORD_BYTES = sizeof(int64_t) + sizeof(uint32_t) + sizeof(uint16_t) + 2 + 6 * sizeof(uint16_t);
+
+    template <typename T>
+    void put(std::string& out, T value)
+    {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        out.append(bytes, sizeof(T));
+    }
+
+    template <typename T>
+    T get(const char*& in)
+    {
+        T value;
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return value;
+    }
+
+    void serialize(std::string& out, const LogRecord& record)
+    {
+        put<int64_t>(out, record.time);
+        put<uint32_t>(out, record.address);
+        put<uint16_t>(out, record.core);
+        put<uint8_t>(out, static_cast<uint8_t>(record.event));
+        put<uint8_t>(out, record.flags);
+        for (const uint16_t operand : record.operands) put<uint16_t>(out, operand);
+        for (const uint16_t value : record.values) put<uint16_t>(out, value);
+
+        if (record.event == LogEvent::eText) {
+            for (const std::string* text : {&record.text->print, &record.text->output}) {
+                put<uint32_t>(out, static_cast<uint32_t>(text->size()));
+                out += *text;
+            }
+        }
+    }
+
+    // Reads one record from in, which must hold at least FIXED_RECORD_BYTES; returns false when an
+    // eText record's strings run past end
+    bool deserialize(const char*& in, const char* end, LogRecord& record)
+    {
+        record.time = static_cast<std::time_t>(get<int64_t>(in));
+        record.address = get<uint32_t>(in);
+        record.core = get<uint16_t>(in);
+        record.event = static_cast<LogEvent>(get<uint8_t>(in));
+        record.flags = get<uint8_t>(in);
+        for (uint16_t& operand : record.operands) operand = get<uint16_t>(in);
+        for (uint16_t& value : record.values) value = get<uint16_t>(in);
+        record.text.reset();
+
+        if (record.event == LogEvent::eText) {
+            LogText text;
+            for (std::string* field : {&text.print, &text.output}) {
+                if (end - in < static_cast<std::ptrdiff_t>(sizeof(uint32_t))) return false;
+                const uint32_t length = get<uint32_t>(in);
+                if (end - in < static_cast<std::ptrdiff_t>(length)) return false;
+                field->assign(in, length);
+                in += length;
+            }
+            record.text = std::make_shared<const LogText>(std::move(text));
+        }
+        return true;
+    }
+}
+
+ProcessLog::ProcessLog(Formatter format, std::string spill_path) : format(std::move(format)), spill_path(std::move(spill_path)) {}
+
+ProcessLog::~ProcessLog()
+{
+    if (spilled_bytes > 0) {
+        std::error_code ec;
+        std::filesystem::remove(spill_path, ec);
+    }
+}
+
+void ProcessLog::set_capacity(size_t capacity)
+{
+    std::lock_guard lock(mutex);
+    this->capacity = std::max<size_t>(capacity, 1);
+}
+
+void ProcessLog::push(LogRecord record)
+{
+    std::lock_guard lock(mutex);
+
+    if (count == capacity) {
+        // Half at a time, so the file is opened once per capacity / 2 records
+        spill_oldest(std::max<size_t>(capacity / 2, 1));
+    }
+
+    if (count < ring.size()) {
+        ring[(head + count) % ring.size()] = std::move(record);
+    } else {
+        // Still growing, so nothing has wrapped yet
+        ring.push_back(std::move(record));
+    }
+    ++count;
+}
+
+void ProcessLog::spill_all()
+{
+    std::lock_guard lock(mutex);
+    spill_oldest(count);
+    ring.clear();
+    ring.shrink_to_fit();
+    head = 0;
+}
+
+void ProcessLog::spill_oldest(size_t n)
+{
+    if (n == 0) return;
+
+    std::string bytes;
+    bytes.reserve(n * FIXED_RECORD_BYTES);
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t seq = first_seq + i;
+        if (seq == unread_seq) unread_offset = spilled_bytes + bytes.size();
+
+        LogRecord& record = ring[(head + i) % ring.size()];
+        serialize(bytes, record);
+        record = {};
+    }
+
+    // The first spill replaces whatever an earlier process with this path left behind. Later ones
+    // write at spilled_bytes rather than the end, past anything a failed write left there.
+    std::ofstream out(spill_path, std::ios::binary | (spilled_bytes == 0 ? std::ios::trunc : std::ios::in));
+    if (out.seekp(static_cast<std::streamoff>(spilled_bytes)) &&
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size())) && out.flush()) {
+        spilled_bytes += bytes.size();
+    } else {
+        if (!gaps.empty() && gaps.back().offset == spilled_bytes) gaps.back().count += n;
+        else gaps.push_back({spilled_bytes, n});
+        // Unread records that never reached the file are gone
+        if (unread_seq >= first_seq && unread_seq < first_seq + n) unread_seq = first_seq + n;
+    }
+
+    head = (head + n) % ring.size();
+    count -= n;
+    first_seq += n;
+}
+
+void ProcessLog::read_spilled(uint64_t begin, uint64_t end, const std::function<void(const LogRecord&)>& sink) const
+{
+    if (begin >= end) return;
+
+    std::ifstream in(spill_path, std::ios::binary);
+    if (!in.seekg(static_cast<std::streamoff>(begin))) return;
+
+    // Record boundaries never line up with chunks, so a partial record is carried over
+    constexpr size_t CHUNK_BYTES = 64 * 1024;
+    std::string buffer;
+    uint64_t remaining = end - begin;
+    LogRecord record;
+    while (remaining > 0) {
+        const size_t carried = buffer.size();
+        const size_t want = static_cast<size_t>(std::min<uint64_t>(remaining, CHUNK_BYTES));
+        buffer.resize(carried + want);
+        if (!in.read(buffer.data() + carried, static_cast<std::streamsize>(want))) return;
+        remaining -= want;
+
+        const char* cursor = buffer.data();
+        const char* buffer_end = buffer.data() + buffer.size();
+        while (buffer_end - cursor >= static_cast<std::ptrdiff_t>(FIXED_RECORD_BYTES)) {
+            const char* record_start = cursor;
+            if (!deserialize(cursor, buffer_end, record)) {
+                cursor = record_start;
+                break;
+            }
+            sink(record);
+        }
+        buffer.erase(0, static_cast<size_t>(cursor - buffer.data()));
+    }
+}
+
+void ProcessLog::read_lines(const std::function<void(std::string_view)>& sink) const
+{
+    std::vector<LogRecord> in_ring;
+    std::vector<SpillGap> lost;
+    uint64_t spilled_end;
+    {
+        std::lock_guard lock(mutex);
+        in_ring.reserve(count);
+        for (size_t i = 0; i < count; ++i) in_ring.push_back(ring[(head + i) % ring.size()]);
+        lost = gaps;
+        spilled_end = spilled_bytes;
+    }
+
+    // The file is append-only, so the part counted by spilled_end cannot change under the reader
+    auto emit = [&](const LogRecord& record) { sink(format(record, false)); };
+    uint64_t offset = 0;
+    for (const SpillGap& gap : lost) {
+        read_spilled(offset, gap.offset, emit);
+        sink(std::format("[LOG] {} entries could not be written to {}", gap.count, spill_path));
+        offset = gap.offset;
+    }
+    read_spilled(offset, spilled_end, emit);
+    for (const auto& record : in_ring) emit(record);
+}
+
+std::vector<std::string> ProcessLog::take_unread()
+{
+    std::vector<LogRecord> in_ring;
+    uint64_t spilled_begin = 0;
+    uint64_t spilled_end = 0;
+    {
+        std::lock_guard lock(mutex);
+        if (unread_seq < first_seq) {
+            spilled_begin = unread_offset;
+            spilled_end = spilled_bytes;
+        }
+        for (uint64_t seq = std::max(unread_seq, first_seq); seq < first_seq + count; ++seq) {
+            in_ring.push_back(ring[(head + (seq - first_seq)) % ring.size()]);
+        }
+        unread_seq = first_seq + count;
+    }
+
+    std::vector<std::string> lines;
+    read_spilled(spilled_begin, spilled_end, [&](const LogRecord& record) { lines.push_back(format(record, true)); });
+    for (const auto& record : in_ring) lines.push_back(format(record, true));
+    return lines;
+}
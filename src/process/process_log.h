@@ -0,0 +1,105 @@
+#ifndef PROCESS_LOG_H
+#define PROCESS_LOG_H
+
+#include <array>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What a LogRecord describes. Instruction events carry the operands and values their log line shows;
+// eText carries lines that were formatted when they were logged.
+enum class LogEvent : uint8_t
+{
+    eText,
+    ePrint,
+    eDeclare,
+    eAdd,
+    eSubtract,
+    eSleep,
+    eRead,
+    eWrite,
+    eVariableError, // a variable operand with no slot; flags holds the instruction's opcode
+    eAccessViolation,
+    eFetchViolation,
+};
+
+struct LogText
+{
+    std::string print;  // as process-smi shows it
+    std::string output; // as screen -r streams it
+};
+
+// One execution-log entry. Operands are string ids, linked addresses and literals exactly as they
+// were in the code segment, so the text is only built by whoever reads the log.
+struct LogRecord
+{
+    std::time_t time = 0;
+    uint32_t address = 0; // READ/WRITE target, SLEEP start tick, faulting PC
+    uint16_t core = 0;
+    LogEvent event = LogEvent::eText;
+    uint8_t flags = 0;
+    std::array<uint16_t, 3> operands{};
+    std::array<uint16_t, 3> values{};
+    std::shared_ptr<const LogText> text; // eText only
+};
+
+// A process's execution log: a ring of at most capacity records in memory, backed by an append-only
+// spill file. When the ring is full the oldest half is appended to the file, still as records, so
+// neither the core that logs nor the spill formats any text. Readers get the file's records first,
+// then the ring's. Safe to use from the core running the process and the UI thread at once.
+class ProcessLog
+{
+public:
+    // Builds the text of a record; output selects the screen -r form over the process-smi one
+    using Formatter = std::function<std::string(const LogRecord& record, bool output)>;
+    static constexpr size_t DEFAULT_CAPACITY = 1000;
+
+    ProcessLog(Formatter format, std::string spill_path);
+    ~ProcessLog();
+
+    // Set before anything is logged
+    void set_capacity(size_t capacity);
+    void push(LogRecord record);
+    // Moves every record to the spill file and frees the ring, for a process that will log no more
+    void spill_all();
+
+    // Every entry as process-smi shows it, oldest first, with a notice where a failed spill lost some
+    void read_lines(const std::function<void(std::string_view)>& sink) const;
+    // The entries screen -r has not taken yet, as it shows them, oldest first
+    std::vector<std::string> take_unread();
+
+private:
+    Formatter format;
+    std::string spill_path;
+    size_t capacity = DEFAULT_CAPACITY;
+
+    std::vector<LogRecord> ring; // grows to capacity, then wraps
+    size_t head = 0;             // slot of the oldest record
+    size_t count = 0;
+    uint64_t first_seq = 0;      // sequence number of the record at head
+    uint64_t unread_seq = 0;     // first record screen -r has not taken
+
+    uint64_t spilled_bytes = 0;  // the file holds exactly this many bytes of records
+    uint64_t unread_offset = 0;  // where unread_seq starts in the file, while it is spilled
+    mutable std::mutex mutex;
+
+    // Records lost because the file could not be written, by the file offset they would have had
+    struct SpillGap
+    {
+        uint64_t offset;
+        uint64_t count;
+    };
+    std::vector<SpillGap> gaps;
+
+    // Caller holds mutex
+    void spill_oldest(size_t n);
+    // Calls sink with each record in [begin, end) of the spill file
+    void read_spilled(uint64_t begin, uint64_t end, const std::function<void(const LogRecord&)>& sink) const;
+};
+
+#endif //PROCESS_LOG_H
@@ -1,9 +1,11 @@
 //
 // Created by Alfon on 6/12/2025.
 //
+#include <algorithm>
 #include <fstream>
 #include <format>
 #include <filesystem>
+#include <utility>
 #include "scheduler.h"
 #include "../cpu_tick.h"
 #include "../memory/memory.h" // Added for global_memory_ptr
@@ -66,9 +68,15 @@ void Scheduler::stop()
 void Scheduler::scheduler_loop()
  {
      uint16_t next_core = 0; // Round-robin assignment to cores
+     auto next_swap_check = std::chrono::steady_clock::now() + SWAP_CHECK_PERIOD;
      
      while (running.load()) {
-         // Check waiting processes and move them if they are done sleeping
+         if (swap_out_fault_rate > 0 && std::chrono::steady_clock::now() >= next_swap_check) {
+             balance_load();
+             next_swap_check = std::chrono::steady_clock::now() + SWAP_CHECK_PERIOD;
+         }
+
+         // Check waiting processes and move them if they are done sleeping and their page-ins landed
          {
              std::lock_guard waiting_lock(waiting_mutex);
              std::queue<std::shared_ptr<Process>> still_waiting;
@@ -76,7 +84,7 @@ void Scheduler::scheduler_loop()
                  auto process = waiting_queue.front();
                  waiting_queue.pop();
 
-                 if (get_cpu_tick() >= process->sleep_until_tick.load()) {
+                 if (get_cpu_tick() >= process->sleep_until_tick.load() && !process->page_in_pending.load()) {
                      process->set_state(ProcessState::eReady);
                      
                      // Directly assign to a specific core's queue for better performance
@@ -116,7 +124,16 @@ void Scheduler::scheduler_loop()
 void Scheduler::add_process(std::shared_ptr<Process> process)
  {
      process->unroll_instructions();
-     process->load_instructions_to_memory();
+     process->set_log_capacity(log_capacity);
+     if (!process->load_instructions_to_memory()) {
+         // Failed to link; it never reaches a core
+         process->free_process_memory();
+         process->spill_log();
+         std::lock_guard finished_lock(finished_mutex);
+         finished_processes.push_back(process);
+         return;
+     }
+     process->set_execution_mode(execution_mode);
 
      process->set_state(ProcessState::eReady);
 
@@ -143,6 +160,8 @@ void Scheduler::add_process(std::shared_ptr<Process> process)
 void Scheduler::cpu_worker(uint16_t core_id)
  {
      static std::atomic<uint64_t> global_quantum_counter{0};
+     Memory::bind_current_thread_to_core(core_id);
+
      while (running.load()) {
          std::shared_ptr<Process> process_to_run = nullptr;
          bool cpu_was_active = false;
@@ -185,7 +204,10 @@ void Scheduler::cpu_worker(uint16_t core_id)
 
              uint32_t ticks_to_run = (scheduler_type == SchedulerType::FCFS) ? 0 : quantum_cycles;
 
+             const uint64_t retired_before = process_to_run->instructions_retired.load(std::memory_order_relaxed);
              process_to_run->execute_from_memory(core_id, ticks_to_run, delay);
+             instructions_retired.fetch_add(process_to_run->instructions_retired.load(std::memory_order_relaxed) - retired_before,
+                                            std::memory_order_relaxed);
 
              // Remove from running processes
              {
@@ -200,9 +222,11 @@ void Scheduler::cpu_worker(uint16_t core_id)
                  std::lock_guard finished_lock(finished_mutex);
                  process_to_run->set_assigned_core(9999);
                  process_to_run->free_process_memory();
+                 // Finished processes are kept for good, so their logs should not stay in memory
+                 process_to_run->spill_log();
                  finished_processes.push_back(process_to_run);
              } else if (process_to_run->get_state() == ProcessState::eWaiting) {
-                 // Still waiting (e.g., sleeping)
+                 // Still waiting (sleeping, or blocked on a page-in)
                  std::lock_guard waiting_lock(waiting_mutex);
                  process_to_run->set_assigned_core(9999);
                  waiting_queue.push(process_to_run);
@@ -232,6 +256,110 @@ void Scheduler::cpu_worker(uint16_t core_id)
      }
  }
 
+void Scheduler::balance_load()
+ {
+     const uint64_t faults = memory->get_page_faults();
+     const uint64_t retired = instructions_retired.load();
+     const uint64_t fault_delta = faults - std::exchange(last_check_faults, faults);
+     const uint64_t retired_delta = retired - std::exchange(last_check_instructions, retired);
+
+     // Faults per 1000 retired instructions over the last period
+     const uint64_t fault_rate = fault_delta * 1000 / std::max<uint64_t>(retired_delta, 1);
+     const size_t free_frames = memory->get_available_memory() / memory->get_page_size();
+     const size_t total_frames = memory->size() / memory->get_page_size();
+
+     // Faults with plenty of free frames are cold misses, not thrashing
+     if (fault_rate > swap_out_fault_rate && free_frames * 8 < total_frames) {
+         if (auto victim = take_swap_victim()) {
+             const size_t released = memory->swap_out_process(victim->id);
+             std::lock_guard swap_lock(swap_mutex);
+             swapped_out.push_back({victim, released, std::chrono::steady_clock::now()});
+             ++swap_outs;
+         }
+         return;
+     }
+
+     if (fault_rate > swap_out_fault_rate / 2) return;
+
+     // Back through the waiting queue, which releases it once any sleep or page-in is over
+     std::shared_ptr<Process> returning;
+     {
+         std::lock_guard swap_lock(swap_mutex);
+         if (swapped_out.empty()) return;
+
+         const auto& oldest = swapped_out.front();
+         if (oldest.frames_released > free_frames ||
+             std::chrono::steady_clock::now() - oldest.swapped_at < MIN_SWAP_OUT_TIME) return;
+         returning = swapped_out.front().process;
+         swapped_out.pop_front();
+     }
+     returning->set_state(ProcessState::eWaiting);
+     {
+         std::lock_guard waiting_lock(waiting_mutex);
+         waiting_queue.push(returning);
+     }
+     ++swap_ins;
+ }
+
+std::shared_ptr<Process> Scheduler::take_swap_victim()
+ {
+     // Same order as scheduler_loop: the waiting queue, then each core's queue
+     std::lock_guard waiting_lock(waiting_mutex);
+     std::vector<std::unique_lock<std::mutex>> core_locks;
+     core_locks.reserve(num_cores);
+     for (auto& core_mutex : per_core_mutexes) {
+         core_locks.emplace_back(*core_mutex);
+     }
+
+     std::vector<std::queue<std::shared_ptr<Process>>*> queues{&waiting_queue};
+     for (auto& queue : per_core_queues) {
+         queues.push_back(&queue);
+     }
+
+     // Rotate every queue once to find the largest resident set. Processes an I/O worker is paging
+     // in are left alone, since their pages are about to be needed.
+     std::shared_ptr<Process> victim;
+     size_t victim_resident = 0;
+     size_t candidates = 0;
+     for (auto* queue : queues) {
+         for (size_t i = queue->size(); i > 0; i--) {
+             auto process = queue->front();
+             queue->pop();
+             queue->push(process);
+             if (process->page_in_pending.load()) continue;
+
+             candidates++;
+             const size_t resident = memory->get_process_memory_usage(process->id);
+             if (!victim || resident > victim_resident) {
+                 victim = process;
+                 victim_resident = resident;
+             }
+         }
+     }
+
+     {
+         std::lock_guard running_lock(running_mutex);
+         if (!victim || victim_resident == 0 || candidates + running_processes.size() < 2) return nullptr;
+     }
+
+     for (auto* queue : queues) {
+         for (size_t i = queue->size(); i > 0; i--) {
+             auto process = queue->front();
+             queue->pop();
+             if (process != victim) queue->push(process);
+         }
+     }
+
+     victim->set_state(ProcessState::eSwappedOut);
+     return victim;
+ }
+
+size_t Scheduler::get_swapped_out_count()
+ {
+     std::lock_guard swap_lock(swap_mutex);
+     return swapped_out.size();
+ }
+
 std::vector<std::shared_ptr<Process>> Scheduler::get_finished()
  {
      std::lock_guard lock(finished_mutex);
@@ -7,6 +7,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <fstream>
 #include <iostream>
@@ -53,9 +54,39 @@ private:
     uint32_t quantum_cycles = 1;
     uint32_t delay = 1;
     SchedulerType scheduler_type = SchedulerType::FCFS;
+    ExecutionMode execution_mode = ExecutionMode::eBytecode;
+    size_t log_capacity = ProcessLog::DEFAULT_CAPACITY;
+
+    // Medium-term scheduling (load control). Every SWAP_CHECK_PERIOD, while free frames are scarce
+    // and the system takes more than swap_out_fault_rate page faults per 1000 retired instructions,
+    // the non-running process with the largest resident set is swapped out and parked in
+    // swapped_out, where no core looks for work. Once the rate falls to half the threshold, the
+    // longest-parked process returns as soon as the frames it gave up are free again and it has been
+    // out for at least MIN_SWAP_OUT_TIME, so a process is not bounced in and out every period.
+    struct SwappedProcess
+    {
+        std::shared_ptr<Process> process;
+        size_t frames_released;
+        std::chrono::steady_clock::time_point swapped_at;
+    };
+    static constexpr auto SWAP_CHECK_PERIOD = std::chrono::milliseconds(100);
+    static constexpr auto MIN_SWAP_OUT_TIME = std::chrono::milliseconds(500);
+    std::shared_ptr<Memory> memory;
+    uint32_t swap_out_fault_rate = 0;
+    std::deque<SwappedProcess> swapped_out;
+    std::mutex swap_mutex; // leaf lock guarding swapped_out
+    std::atomic<uint64_t> instructions_retired{0};
+    uint64_t last_check_faults = 0;
+    uint64_t last_check_instructions = 0;
+    std::atomic<uint64_t> swap_outs{0};
+    std::atomic<uint64_t> swap_ins{0};
 
     void scheduler_loop();
     void cpu_worker(uint16_t core_id);
+    void balance_load();
+    // Removes and returns the waiting or ready process with the most resident pages, or nullptr
+    // when that would leave nothing else to run
+    std::shared_ptr<Process> take_swap_victim();
 
 public:
     explicit Scheduler(uint16_t num_cores = 4);
@@ -74,12 +105,28 @@ public:
 
     std::string get_status_string();
 
+    // 0 turns the medium-term scheduler off. Set before start().
+    void set_load_control(std::shared_ptr<Memory> memory, uint32_t swap_out_fault_rate)
+    {
+        this->memory = std::move(memory);
+        this->swap_out_fault_rate = swap_out_fault_rate;
+    }
+    uint64_t get_instructions_retired() const { return instructions_retired.load(); }
+    uint64_t get_swap_outs() const { return swap_outs.load(); }
+    uint64_t get_swap_ins() const { return swap_ins.load(); }
+    size_t get_swapped_out_count();
+
     void set_delay(uint32_t delay) { this->delay = delay; }
     void set_quantum_cycles(uint32_t q) { quantum_cycles = q; }
     void set_scheduler_type(SchedulerType t) { scheduler_type = t; }
+    // Applied to every process added from then on
+    void set_execution_mode(ExecutionMode mode) { execution_mode = mode; }
+    void set_log_capacity(size_t capacity) { log_capacity = capacity; }
     uint32_t get_delay() const { return delay; }
     uint32_t get_quantum_cycles() const { return quantum_cycles; }
     SchedulerType get_scheduler_type() const { return scheduler_type; }
+    ExecutionMode get_execution_mode() const { return execution_mode; }
+    size_t get_log_capacity() const { return log_capacity; }
 };
 
 #endif //SCHEDULER_H
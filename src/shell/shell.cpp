@@ -184,9 +184,9 @@ void Shell::shell_loop(bool print_header)
         apheli_os.process_command(input);
 
         if (apheli_os.current_session && apheli_os.current_session->process) {
-            output_buffer.insert(output_buffer.end(), apheli_os.current_session->process->output_buffer.begin(),
-                                 apheli_os.current_session->process->output_buffer.end());
-            apheli_os.current_session->process->output_buffer.clear();
+            for (auto& line : apheli_os.current_session->process->take_output_lines()) {
+                output_buffer.push_back(std::move(line));
+            }
         }
 
         output_buffer.push_back("");
@@ -0,0 +1,152 @@
+// Failure injection for the backing store: stores that cannot open their file, and page-outs that
+// fail, with and without write-behind. No page may ever read back stale contents.
+
+#include "memory/backing_store.h"
+#include "memory/memory.h"
+#include "test_support.h"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+
+namespace
+{
+    // Runs each test in a scratch directory, since Memory keeps its page file in the working directory
+    class ScratchDirectory
+    {
+        std::filesystem::path previous;
+        std::filesystem::path path;
+
+    public:
+        explicit ScratchDirectory(std::string_view name) :
+            previous(std::filesystem::current_path()),
+            path(std::filesystem::temp_directory_path() / std::format("backing_store_test_{}", name))
+        {
+            std::filesystem::remove_all(path);
+            std::filesystem::create_directories(path);
+            std::filesystem::current_path(path);
+        }
+
+        ~ScratchDirectory()
+        {
+            std::filesystem::current_path(previous);
+            std::error_code ec;
+            std::filesystem::remove_all(path, ec);
+        }
+    };
+
+    void test_factory_probes_path()
+    {
+        ScratchDirectory scratch("factory");
+
+        check(!create_backing_store("tape", "pages.bin", 64, 256, 0), "unknown store name is rejected");
+        check(!create_backing_store("fstream", "missing/pages.bin", 64, 256, 0), "fstream store whose directory is missing is rejected");
+        check(!create_backing_store("mmap", "missing/pages.bin", 64, 256, 0), "mmap store whose directory is missing is rejected");
+
+        for (const char* name : {"fstream", "mmap"}) {
+            auto store = create_backing_store(name, std::format("{}.bin", name), 64, 256, 0);
+            check(store != nullptr, "store with a usable path is created");
+            if (!store) continue;
+
+            check(!std::filesystem::exists(std::format("{}.bin", name)), "the file is not created before the first slot");
+            std::vector<uint8_t> page(256, 0x5A);
+            std::vector<uint8_t> copy(256);
+            const auto slot = store->allocate_slot();
+            check(std::filesystem::exists(std::format("{}.bin", name)), "the file is created with the first slot");
+            check(slot && store->write_page(*slot, page.data()) && store->read_page(*slot, copy.data()) && copy == page,
+                  "a page written to a new slot reads back");
+        }
+    }
+
+    void test_fallback_to_fstream()
+    {
+        ScratchDirectory scratch("fallback");
+
+        // A directory where the page file should be makes every store fail the probe
+        std::filesystem::create_directory("csopesy-backing-store.txt");
+        Memory memory(4 * 256, 256, 4, 1);
+        check(!memory.set_backing_store("mmap"), "set_backing_store reports a store that cannot open its file");
+        check(memory.get_backing_store_name() == "fstream", "the fstream store is used instead");
+
+        std::filesystem::remove("csopesy-backing-store.txt");
+        check(memory.set_backing_store("mmap"), "the mmap store is used once its file can be created");
+        check(memory.get_backing_store_name() == "mmap", "the mmap store is selected");
+    }
+
+    // The fstream store, with page writes that can be made to fail
+    class FailingBackingStore : public FileBackingStore
+    {
+    public:
+        std::atomic<bool> writes_fail{false};
+
+        using FileBackingStore::FileBackingStore;
+
+        bool write_page(uint32_t slot, const uint8_t* page_data) override
+        {
+            return !writes_fail && FileBackingStore::write_page(slot, page_data);
+        }
+
+        bool write_pages(std::span<const uint32_t> slots, std::span<const uint8_t* const> pages) override
+        {
+            return !writes_fail && FileBackingStore::write_pages(slots, pages);
+        }
+    };
+
+    // Four frames under sixteen pages, so every pass over the pages pages out dirty ones
+    void test_failed_page_outs(unsigned io_threads)
+    {
+        ScratchDirectory scratch(std::format("page_out_{}", io_threads));
+        constexpr uint32_t PID = 1;
+        constexpr uint32_t PAGES = 16;
+        constexpr uint32_t PAGE_SIZE = 256;
+
+        Memory memory(4 * PAGE_SIZE, PAGE_SIZE, 4, 1);
+        Memory::bind_current_thread_to_core(0);
+        auto owned_store = std::make_unique<FailingBackingStore>("pages.bin", 64, PAGE_SIZE);
+        FailingBackingStore& store = *owned_store;
+        memory.set_backing_store(std::move(owned_store));
+        memory.set_io_threads(io_threads);
+        memory.create_process_space(PID, PAGES * PAGE_SIZE);
+
+        // First pass while writes work
+        std::vector<uint16_t> expected(PAGES);
+        for (uint32_t page = 0; page < PAGES; page++) {
+            expected[page] = static_cast<uint16_t>(100 + page);
+            check(memory.write_word(PID, static_cast<uint16_t>(page * PAGE_SIZE), expected[page]), "write before the failure");
+        }
+
+        // Page-outs now fail. An access may be refused when no frame can be freed, but a page that
+        // is read back must hold the last accepted write, so each page is read before it is written.
+        store.writes_fail = true;
+        for (uint32_t pass = 0; pass < 3; pass++) {
+            for (uint32_t page = 0; page < PAGES; page++) {
+                const auto read_back = memory.read_word(PID, page * PAGE_SIZE);
+                if (read_back) check(*read_back == expected[page], "a page read while writes fail is current");
+
+                const auto value = static_cast<uint16_t>(1000 * (pass + 1) + page);
+                if (memory.write_word(PID, static_cast<uint16_t>(page * PAGE_SIZE), value)) expected[page] = value;
+            }
+        }
+        store.writes_fail = false;
+
+        for (uint32_t pass = 0; pass < 2; pass++) {
+            for (uint32_t page = 0; page < PAGES; page++) {
+                const auto read_back = memory.read_word(PID, page * PAGE_SIZE);
+                check(read_back && *read_back == expected[page], "every page reads back current once writes work again");
+            }
+        }
+        memory.destroy_process_space(PID);
+    }
+}
+
+int main()
+{
+    test_factory_probes_path();
+    test_fallback_to_fstream();
+    test_failed_page_outs(0);
+    test_failed_page_outs(2);
+
+    if (failures == 0) std::printf("all backing store checks passed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+// Runs random programs through the reference IInstruction classes and the bytecode engine and checks
+// that both leave the same memory, PC, retired count, process-smi log and screen -r output.
+// Programs include overflowing literals, out-of-range READ/WRITE addresses and writes into the code
+// segment, so the error paths and unlinked operands are compared too.
+
+#include "cpu_tick.h"
+#include "process/instruction.h"
+#include "process/process.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <regex>
+#include <thread>
+
+namespace
+{
+    struct RunResult
+    {
+        std::vector<std::string> log_lines;
+        std::vector<std::string> output_lines;
+        std::vector<uint8_t> memory;
+        uint32_t program_counter = 0;
+        uint64_t retired = 0;
+
+        bool operator==(const RunResult&) const = default;
+    };
+
+    std::vector<std::shared_ptr<IInstruction>> generate_program(std::mt19937& rng, int length, uint32_t memory_size)
+    {
+        static constexpr const char* NAMES[] = {"a", "b", "c", "longer_variable_name_x", "y", "z", "w"};
+        auto variable = [&] { return std::string(NAMES[rng() % std::size(NAMES)]); };
+        auto literal = [&] { return static_cast<uint16_t>(rng() % 3 == 0 ? 65000 + rng() % 500 : rng() % 100); };
+        // One address in eight is past the end of memory
+        auto address = [&] { return rng() % 8 == 0 ? memory_size + rng() % 100 : rng() % memory_size; };
+
+        std::vector<std::shared_ptr<IInstruction>> program;
+        for (int i = 0; i < length; i++) {
+            switch (rng() % 8) {
+                case 0:
+                    program.push_back(std::make_shared<DeclareInstruction>(variable(), literal()));
+                    break;
+                case 1:
+                case 2: {
+                    const bool add = rng() % 2 == 0;
+                    const std::string target = variable();
+                    auto make = [&](auto lhs, auto rhs) -> std::shared_ptr<IInstruction> {
+                        if (add) return std::make_shared<AddInstruction>(target, lhs, rhs);
+                        return std::make_shared<SubtractInstruction>(target, lhs, rhs);
+                    };
+                    switch (rng() % 4) {
+                        case 0: program.push_back(make(variable(), variable())); break;
+                        case 1: program.push_back(make(variable(), literal())); break;
+                        case 2: program.push_back(make(literal(), variable())); break;
+                        default: program.push_back(make(literal(), literal())); break;
+                    }
+                    break;
+                }
+                case 3:
+                    if (rng() % 2 == 0) program.push_back(std::make_shared<PrintInstruction>("value " + std::to_string(rng() % 5), variable()));
+                    else program.push_back(std::make_shared<PrintInstruction>("Hello world from a long message"));
+                    break;
+                case 4:
+                    program.push_back(std::make_shared<SleepInstruction>(rng() % 3));
+                    break;
+                case 5:
+                    program.push_back(std::make_shared<ReadInstruction>(variable(), address()));
+                    break;
+                case 6:
+                    if (rng() % 2 == 0) program.push_back(std::make_shared<WriteInstruction>(address(), variable()));
+                    else program.push_back(std::make_shared<WriteInstruction>(address(), literal()));
+                    break;
+                default:
+                    // Self-modifying: overwrite a word of the code segment
+                    program.push_back(std::make_shared<WriteInstruction>(static_cast<uint32_t>(rng() % (length * 8)), static_cast<uint16_t>(rng())));
+                    break;
+            }
+        }
+        return program;
+    }
+
+    // Timestamps and sleep ticks depend on when the run happened, not on the engine
+    std::string normalize(std::string line)
+    {
+        static const std::regex timestamp(R"(^\(\d\d/\d\d/\d{4} \d\d:\d\d:\d\d\) )");
+        static const std::regex sleep_ticks(R"(start: \d+ end: \d+)");
+        return std::regex_replace(std::regex_replace(line, timestamp, "<time> "), sleep_ticks, "<ticks>");
+    }
+
+    RunResult run(const std::vector<std::shared_ptr<IInstruction>>& program, uint32_t memory_size,
+                  ExecutionMode mode, size_t log_capacity)
+    {
+        auto memory = std::make_shared<Memory>(64 * 64, 64, 64, 1);
+        Memory::bind_current_thread_to_core(0);
+        memory->create_process_space(7, memory_size);
+
+        auto process = std::make_shared<Process>(7, "differential", memory);
+        for (const auto& instruction : program) process->add_instruction(instruction);
+        // Small rings make both engines spill, and take_output_lines read across the spills
+        process->set_log_capacity(log_capacity);
+        process->load_instructions_to_memory();
+        process->set_execution_mode(mode);
+        process->set_assigned_core(0);
+
+        RunResult result;
+        for (int step = 0; step < 100000; step++) {
+            process->execute_from_memory(0, 0, 0);
+            if (step % 3 == 0) {
+                for (auto& line : process->take_output_lines()) result.output_lines.push_back(normalize(std::move(line)));
+            }
+
+            const ProcessState state = process->get_state();
+            if (state != ProcessState::eWaiting) break;
+            process->set_state(ProcessState::eRunning);
+        }
+
+        if (log_capacity % 2 == 1) process->spill_log();
+        for (auto& line : process->take_output_lines()) result.output_lines.push_back(normalize(std::move(line)));
+        process->read_log_lines([&result](std::string_view line) { result.log_lines.push_back(normalize(std::string(line))); });
+
+        result.memory.resize(memory_size);
+        for (uint32_t address = 0; address < memory_size; address++) {
+            result.memory[address] = process->read_memory_byte(address).value_or(0xEE);
+        }
+        result.program_counter = process->get_program_counter();
+        result.retired = process->instructions_retired.load();
+        return result;
+    }
+
+    void print_first_difference(const std::vector<std::string>& reference, const std::vector<std::string>& bytecode)
+    {
+        for (size_t i = 0; i < std::max(reference.size(), bytecode.size()); i++) {
+            const std::string& expected = i < reference.size() ? reference[i] : "<none>";
+            const std::string& actual = i < bytecode.size() ? bytecode[i] : "<none>";
+            if (expected != actual) {
+                std::printf("  line %zu\n    reference: %s\n    bytecode:  %s\n", i, expected.c_str(), actual.c_str());
+                return;
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int trials = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    // SLEEP waits on the CPU tick, so something has to advance it
+    std::atomic<bool> ticking{true};
+    std::thread clock([&ticking] {
+        while (ticking) {
+            increment_cpu_tick();
+            std::this_thread::sleep_for(std::chrono::microseconds(2));
+        }
+    });
+
+    int failures = 0;
+    for (int trial = 0; trial < trials; trial++) {
+        std::mt19937 rng(trial);
+        const uint32_t memory_size = rng() % 2 == 0 ? 1024 : 2048;
+        const auto program = generate_program(rng, 20 + static_cast<int>(rng() % 80), memory_size);
+
+        const RunResult reference = run(program, memory_size, ExecutionMode::eReference, 1 + (trial + 3) % 9);
+        const RunResult bytecode = run(program, memory_size, ExecutionMode::eBytecode, 1 + trial % 7);
+        if (reference == bytecode) continue;
+
+        failures++;
+        std::printf("trial %d differs: pc %u/%u, retired %llu/%llu, memory %s\n", trial,
+                    reference.program_counter, bytecode.program_counter,
+                    static_cast<unsigned long long>(reference.retired), static_cast<unsigned long long>(bytecode.retired),
+                    reference.memory == bytecode.memory ? "same" : "differs");
+        print_first_difference(reference.log_lines, bytecode.log_lines);
+        print_first_difference(reference.output_lines, bytecode.output_lines);
+    }
+
+    ticking = false;
+    clock.join();
+
+    std::printf("%d of %d trials differ\n", failures, trials);
+    return failures == 0 ? 0 : 1;
+}
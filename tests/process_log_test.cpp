@@ -0,0 +1,134 @@
+// Round trips records through ProcessLog's ring and spill file, and checks that screen -r's unread
+// cursor survives spills, including one that fails.
+
+#include "process/process_log.h"
+#include "test_support.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <format>
+
+namespace
+{
+    std::string format_record(const LogRecord& record, bool output)
+    {
+        if (record.event == LogEvent::eText) return output ? record.text->output : record.text->print;
+        return std::format("{} {}", output ? "output" : "print", record.address);
+    }
+
+    LogRecord numbered(uint32_t number)
+    {
+        LogRecord record;
+        record.event = LogEvent::eSleep;
+        record.address = number;
+        return record;
+    }
+
+    std::vector<std::string> expected_lines(std::string_view prefix, uint32_t first, uint32_t last)
+    {
+        std::vector<std::string> lines;
+        for (uint32_t number = first; number < last; number++) lines.push_back(std::format("{} {}", prefix, number));
+        return lines;
+    }
+
+    std::vector<std::string> read_all(const ProcessLog& log)
+    {
+        std::vector<std::string> lines;
+        log.read_lines([&lines](std::string_view line) { lines.emplace_back(line); });
+        return lines;
+    }
+
+    std::string spill_path(std::string_view name)
+    {
+        return (std::filesystem::temp_directory_path() / std::format("process_log_test_{}.bin", name)).string();
+    }
+
+    void test_spill_round_trip()
+    {
+        ProcessLog log(format_record, spill_path("round_trip"));
+        log.set_capacity(4);
+        for (uint32_t number = 0; number < 10; number++) log.push(numbered(number));
+
+        check(read_all(log) == expected_lines("print", 0, 10), "read_lines returns spilled and ring records in order");
+        check(read_all(log) == expected_lines("print", 0, 10), "read_lines can be repeated");
+        check(log.take_unread() == expected_lines("output", 0, 10), "take_unread returns every record once");
+        check(log.take_unread().empty(), "take_unread is empty once everything is taken");
+    }
+
+    void test_unread_across_spills()
+    {
+        ProcessLog log(format_record, spill_path("unread"));
+        log.set_capacity(4);
+        for (uint32_t number = 0; number < 3; number++) log.push(numbered(number));
+        check(log.take_unread() == expected_lines("output", 0, 3), "take_unread before any spill");
+
+        // Records 0-2 were taken; 3 is unread when it spills
+        for (uint32_t number = 3; number < 12; number++) log.push(numbered(number));
+        check(log.take_unread() == expected_lines("output", 3, 12), "take_unread resumes inside the spill file");
+
+        log.push(numbered(12));
+        log.spill_all();
+        check(log.take_unread() == expected_lines("output", 12, 13), "take_unread after spill_all");
+        check(read_all(log) == expected_lines("print", 0, 13), "read_lines after spill_all");
+    }
+
+    void test_text_records()
+    {
+        ProcessLog log(format_record, spill_path("text"));
+        log.set_capacity(2);
+
+        const std::vector<std::string> prints = {"", "first \"quoted\" line", std::string(70000, 'x'), "last"};
+        for (const auto& print : prints) {
+            LogRecord record;
+            record.text = std::make_shared<const LogText>(LogText{print, "[OUT] " + print});
+            log.push(std::move(record));
+        }
+        log.spill_all();
+
+        std::vector<std::string> outputs;
+        for (const auto& print : prints) outputs.push_back("[OUT] " + print);
+        check(read_all(log) == prints, "text records keep both strings through the spill file");
+        check(log.take_unread() == outputs, "text records are read back across chunk boundaries");
+    }
+
+    // A spill that fails after unread records already reached the file must not skip them
+    void test_failed_spill_keeps_unread_file_records()
+    {
+        const std::string path = spill_path("failed");
+        ProcessLog log(format_record, path);
+        log.set_capacity(4);
+        for (uint32_t number = 0; number < 5; number++) log.push(numbered(number));
+
+        // Records 0 and 1 are in the file and unread. With the file moved aside and a directory in
+        // its place, the next spill, of records 2 and 3, cannot open it.
+        const std::string aside = path + ".aside";
+        std::filesystem::rename(path, aside);
+        std::filesystem::create_directory(path);
+
+        log.push(numbered(5));
+        log.push(numbered(6));
+        std::filesystem::remove(path);
+        std::filesystem::rename(aside, path);
+
+        std::vector<std::string> expected = expected_lines("output", 0, 2);
+        for (const auto& line : expected_lines("output", 4, 7)) expected.push_back(line);
+        check(log.take_unread() == expected, "failed spill drops only its own records");
+
+        const auto lines = read_all(log);
+        check(lines.size() == 6 && lines[2].starts_with("[LOG] 2 entries could not be written"),
+              "read_lines reports the dropped records where they were");
+        check(lines.size() == 6 && lines[0] == "print 0" && lines[1] == "print 1" && lines[3] == "print 4",
+              "read_lines keeps the records around the gap in order");
+    }
+}
+
+int main()
+{
+    test_spill_round_trip();
+    test_unread_across_spills();
+    test_text_records();
+    test_failed_spill_keeps_unread_file_records();
+
+    if (failures == 0) std::printf("all process log checks passed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,16 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <cstdio>
+
+// Checks record failures and carry on, so one run reports every broken expectation
+inline int failures = 0;
+
+inline void check(bool condition, const char* what)
+{
+    if (condition) return;
+    std::printf("FAILED: %s\n", what);
+    failures++;
+}
+
+#endif //TEST_SUPPORT_H